@@ -1,11 +1,330 @@
 #include <benchmark/benchmark.h>
 
+#include <algorithm>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
 
-static void BM_SomeFunction(benchmark::State& state) {
-    for (auto _ : state) {
+#include "pc/parsecomb/branch.h"
+#include "pc/parsecomb/functional.h"
+#include "pc/parsecomb/incremental.h"
+#include "pc/parsecomb/json.h"
+#include "pc/parsecomb/keywords.h"
+#include "pc/parsecomb/machine.h"
+#include "pc/parsecomb/multi.h"
+#include "pc/parsecomb/sequence.h"
+#include "pc/parsecomb/types.h"
+#include "pc/parsecomb/units.h"
 
+#include "utils/jsgrammar.h"
+
+static std::string deep_json(size_t depth) {
+    return std::string(depth, '[') + "1" + std::string(depth, ']');
+}
+
+static std::string wide_json(size_t width) {
+    std::string result = "[";
+    for (size_t i = 0; i < width; i++) {
+        if (i)
+            result += ", ";
+
+        result += R"({"id": )" + std::to_string(i) + R"(, "name": "item", "tags": [1, 2, 3]})";
+    }
+
+    return result + "]";
+}
+
+static void run_closure(benchmark::State &state, const std::string &input) {
+    for (auto _: state) {
+        pc::StringRef view(input);
+        auto result = js::parser::json(view);
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetBytesProcessed(state.iterations() * input.size());
+    state.counters["grammar_bytes"] = static_cast<double>(js::parser::footprint());
+}
+
+static void run_machine(benchmark::State &state, const std::string &input) {
+    const auto json = js::machine::json();
+
+    for (auto _: state) {
+        pc::StringRef view(input);
+        auto captures = json(view);
+        auto result = js::machine::from_captures(input, captures.value());
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetBytesProcessed(state.iterations() * input.size());
+    state.counters["grammar_bytes"] = static_cast<double>(json.code().size() * sizeof(pc::vm::Instruction));
+}
+
+static void BM_ClosureJsonDeep(benchmark::State &state) {
+    run_closure(state, deep_json(state.range(0)));
+}
+
+static void BM_MachineJsonDeep(benchmark::State &state) {
+    run_machine(state, deep_json(state.range(0)));
+}
+
+static void BM_ClosureJsonWide(benchmark::State &state) {
+    run_closure(state, wide_json(state.range(0)));
+}
+
+static void BM_MachineJsonWide(benchmark::State &state) {
+    run_machine(state, wide_json(state.range(0)));
+}
+
+// Prefix-free, so first match and longest match agree.
+static std::vector<std::string> keywords(size_t count) {
+    std::mt19937 random(count);
+    std::uniform_int_distribution<size_t> size(3, 12);
+    std::uniform_int_distribution<int> letter('a', 'z');
+
+    std::vector<std::string> result;
+    while (result.size() < count) {
+        std::string keyword(size(random), ' ');
+        for (auto &ch: keyword)
+            ch = static_cast<char>(letter(random));
+
+        auto is_prefix = [&](const std::string &other) { return other.starts_with(keyword) || keyword.starts_with(other); };
+        if (std::none_of(result.begin(), result.end(), is_prefix))
+            result.push_back(keyword);
+    }
+
+    return result;
+}
+
+static std::string keyword_stream(const std::vector<std::string> &words) {
+    std::mt19937 random(words.size());
+    std::uniform_int_distribution<size_t> pick(0, words.size() - 1);
+
+    std::string result;
+    for (size_t i = 0; i < 4096; i++)
+        result += words[pick(random)] + " ";
+
+    return result;
+}
+
+template<typename P>
+static void run_keywords(benchmark::State &state, const std::string &input, const P &keyword) {
+    const auto space = pc::chr(' ');
+
+    for (auto _: state) {
+        pc::StringRef view(input);
+        size_t sum = 0;
+        while (!view.empty()) {
+            sum += keyword(view).value();
+            space(view);
+        }
+
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+
+static void BM_OneOfTags(benchmark::State &state) {
+    auto words = keywords(state.range(0));
+    std::vector<pc::StringRef> refs(words.begin(), words.end());
+
+    run_keywords(state, keyword_stream(words), pc::one_of_tags(refs));
+}
+
+// What `alt(tag(...), ...)` does: try every literal in order from the same position.
+static void BM_AltTags(benchmark::State &state) {
+    auto words = keywords(state.range(0));
+    std::vector<decltype(pc::tag(""))> tags;
+    for (const auto &word: words)
+        tags.push_back(pc::tag(word));
+
+    auto keyword = [&tags](pc::StringRef &input) -> pc::ParseResult<size_t> {
+        for (size_t i = 0; i < tags.size(); i++) {
+            if (tags[i](input))
+                return i;
+        }
+
+        return std::unexpected(pc::ParseError::Unknown);
+    };
+
+    run_keywords(state, keyword_stream(words), keyword);
+}
+
+static std::string string_corpus(const std::string &piece) {
+    std::string result = "\"";
+    while (result.size() < (1 << 16))
+        result += piece;
+
+    return result + "\"";
+}
+
+static void run_json_string(benchmark::State &state, const std::string &input) {
+    const auto string = pc::json_string();
+
+    for (auto _: state) {
+        pc::StringRef view(input);
+        auto result = string(view);
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+
+static void BM_JsonStringAscii(benchmark::State &state) {
+    run_json_string(state, string_corpus("The quick brown fox jumps over the lazy dog. "));
+}
+
+static void BM_JsonStringEscapes(benchmark::State &state) {
+    run_json_string(state, string_corpus(R"(line\n\t\"quoted\" C:\\path\/x \u00e9\uD83D\uDE00 )"));
+}
+
+static void BM_JsonStringMultibyte(benchmark::State &state) {
+    run_json_string(state, string_corpus("\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82, \xE4\xB8\x96\xE7\x95\x8C \xF0\x9F\x98\x80 caf\xC3\xA9 "));
+}
+
+// Arrays of `width` items nested `depth` times around small objects; depth 4 is about 50 MB.
+static std::string nested_json(size_t depth, size_t width, size_t &counter) {
+    if (!depth)
+        return R"({"id": )" + std::to_string(100000 + counter++) + R"(, "name": "item", "tags": [1, 2, 3]})";
+
+    std::string result = "[";
+    for (size_t i = 0; i < width; i++) {
+        if (i)
+            result += ", ";
+
+        result += nested_json(depth - 1, width, counter);
     }
+
+    return result + "]";
+}
+
+static std::string nested_json(size_t depth) {
+    size_t counter = 0;
+    return nested_json(depth, 32, counter);
 }
 
-BENCHMARK(BM_SomeFunction);
-BENCHMARK_MAIN();
\ No newline at end of file
+static void BM_IncrementalEdit(benchmark::State &state) {
+    auto text = nested_json(state.range(0));
+
+    std::vector<size_t> digits;
+    for (auto position = text.find("\"id\": "); position != std::string::npos; position = text.find("\"id\": ", position + 1))
+        digits.push_back(position + 10);
+
+    pc::Incremental document(js::incremental::parser::json, std::move(text), state.range(1));
+    if (!document.parse())
+        state.SkipWithError("initial parse failed");
+
+    std::mt19937 random(0);
+    for (auto _: state) {
+        auto offset = digits[random() % digits.size()];
+        document.edit(offset, 1, std::string(1, static_cast<char>('0' + random() % 10)));
+
+        auto result = document.parse();
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.counters["document_bytes"] = static_cast<double>(document.text().size());
+    state.counters["memoized"] = static_cast<double>(document.memo().size());
+}
+
+static void BM_FullReparse(benchmark::State &state) {
+    run_closure(state, nested_json(state.range(0)));
+}
+
+// A few fields of a wide document; compare with BM_ClosureJsonWide, which builds all of it.
+static void BM_JsonSelect(benchmark::State &state) {
+    auto input = wide_json(state.range(0));
+    auto middle = std::to_string(state.range(0) / 2);
+    auto last = std::to_string(state.range(0) - 1);
+    std::vector<std::string> pointers = {"/0/id", "/" + middle + "/name", "/" + last + "/tags/2", "/" + last + "/id"};
+    auto select = pc::json_select(std::vector<pc::StringRef>(pointers.begin(), pointers.end()), js::parser::json);
+
+    for (auto _: state) {
+        pc::StringRef view(input);
+        auto result = select(view);
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+
+// `name = 123` settings between blanks and `#` comments. `Share` decides whether each
+// setting gets its own copies of the blank rule or refers to the single one.
+const auto blank = pc::many_any(pc::alt(pc::to(pc::chr(' ') | pc::chr('\n') | pc::chr('\t'), pc::Nothing),
+                                        pc::to(pc::take<0>(pc::chr('#'), pc::many_any(pc::char_range(' ', '~')), pc::chr('\n')), pc::Nothing)));
+
+struct Copied {
+    template<typename P>
+    P operator()(const P &parser) const {
+        return parser;
+    }
+};
+
+struct Referenced {
+    template<typename P>
+    auto operator()(const P &parser) const {
+        return pc::ref(parser);
+    }
+};
+
+static const std::vector<std::string> &setting_names() {
+    static const auto names = [] {
+        std::vector<std::string> result;
+        for (size_t i = 0; i < 256; i++)
+            result.push_back("setting_" + std::to_string(i));
+
+        return result;
+    }();
+
+    return names;
+}
+
+template<typename Share, size_t... I>
+auto settings(Share share, std::index_sequence<I...>) {
+    return pc::many_any(pc::alt(pc::take<5>(share(blank), pc::tag(setting_names()[I]), share(blank), pc::chr('='),
+                                            share(blank), pc::int32())...));
+}
+
+template<size_t Count, typename Share>
+static void BM_Settings(benchmark::State &state) {
+    static const auto grammar = settings(Share{}, std::make_index_sequence<Count>{});
+
+    std::mt19937 random(0);
+    std::string input;
+    for (size_t i = 0; i < 4096; i++) {
+        input += setting_names()[random() % Count] + " = " + std::to_string(random() % 1000) + "\n";
+        if (i % 4 == 0)
+            input += "# comment\n";
+    }
+
+    for (auto _: state) {
+        pc::StringRef view(input);
+        auto result = grammar(view);
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetBytesProcessed(state.iterations() * input.size());
+    state.counters["grammar_bytes"] = static_cast<double>(sizeof(grammar));
+}
+
+// The closure engine is bounded by the thread's stack, so deep inputs stay moderate.
+BENCHMARK(BM_ClosureJsonDeep)->RangeMultiplier(4)->Range(16, 256);
+BENCHMARK(BM_MachineJsonDeep)->RangeMultiplier(4)->Range(16, 256);
+BENCHMARK(BM_ClosureJsonWide)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK(BM_MachineJsonWide)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK(BM_OneOfTags)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_AltTags)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_JsonStringAscii);
+BENCHMARK(BM_JsonStringEscapes);
+BENCHMARK(BM_JsonStringMultibyte);
+BENCHMARK(BM_JsonSelect)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK(BM_Settings<16, Copied>);
+BENCHMARK(BM_Settings<16, Referenced>);
+BENCHMARK(BM_Settings<128, Copied>);
+BENCHMARK(BM_Settings<128, Referenced>);
+// Fixed iteration counts: the initial parse of the large documents dominates otherwise.
+BENCHMARK(BM_IncrementalEdit)->ArgsProduct({{2, 3, 4}, {0, 1024}})->Iterations(100)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FullReparse)->DenseRange(2, 3)->Iterations(3)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
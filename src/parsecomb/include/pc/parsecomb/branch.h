@@ -16,7 +16,7 @@ auto alt(P parser) {
         ResultBuilder<ValueT> guard(input);
         PC_EXPECT_ASSIGN(result, parser(input));
 
-        return guard.build(result);
+        return guard.build(std::move(result));
     };
 }
 
@@ -25,12 +25,12 @@ template<typename HeadP, typename... TailPs>
 auto alt(HeadP p_head, TailPs... p_tail) {
     using ValueT = typename std::invoke_result_t<HeadP, StringRef &>::value_type;
 
-    return [p_head, p_tail...](StringRef &input) -> ParseResult<ValueT> {
+    // The alternative of the tail is built once here rather than on every call.
+    return [p_head, p_rest = alt(p_tail...)](StringRef &input) -> ParseResult<ValueT> {
         ResultBuilder<ValueT> guard(input);
-        auto result_with_error = p_head(input).or_else([&](auto) { return alt(p_tail...)(input); });
-        PC_EXPECT_ASSIGN(result, result_with_error);
+        PC_EXPECT_ASSIGN(result, p_head(input).or_else([&](auto) { return p_rest(input); }));
 
-        return guard.build(result);
+        return guard.build(std::move(result));
     };
 }
 
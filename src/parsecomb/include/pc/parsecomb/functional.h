@@ -2,6 +2,7 @@
 
 #include "pc/parsecomb/types.h"
 #include "pc/parsecomb/traits.h"
+#include <memory>
 #include <tuple>
 #include <type_traits>
 
@@ -12,7 +13,7 @@ auto map(Parser p, F f) {
     return [p, f](StringRef& input) -> ParseResult<std::invoke_result_t<F, typename std::invoke_result_t<Parser, StringRef&>::value_type>> {
         PC_EXPECT_ASSIGN(result, p(input));
 
-        return f(result);
+        return f(std::move(result));
     };
 }
 
@@ -21,4 +22,27 @@ auto to(Parser p, EmitT emit) {
     return map(p, [emit](const auto&) { return emit; });
 }
 
+/**
+ * Uses `parser` without copying it into the enclosing combinator, which holds a pointer instead.
+ * Meant for rules shared by many others, e.g. whitespace; `parser` must outlive every user,
+ * as namespace-scope rules do.
+ */
+template<typename Parser>
+auto ref(const Parser &parser) {
+    return [p = &parser](StringRef &input) { return (*p)(input); };
+}
+
+// A temporary would be gone before the first use.
+template<typename Parser>
+auto ref(const Parser &&) = delete;
+
+/**
+ * Like `ref`, for rules built at run time: one copy of `parser` is kept on the heap and
+ * owned by all users together.
+ */
+template<typename Parser>
+auto share(Parser parser) {
+    return [p = std::make_shared<const Parser>(std::move(parser))](StringRef &input) { return (*p)(input); };
+}
+
 }
\ No newline at end of file
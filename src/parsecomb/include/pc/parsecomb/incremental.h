@@ -0,0 +1,236 @@
+#pragma once
+
+#include "pc/parsecomb/types.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace pc {
+
+/**
+ * Results of `memo` rules keyed by rule and input offset. Each entry remembers how many
+ * bytes it consumed and how many it examined, so an edit drops exactly the entries that
+ * looked at the edited bytes and shifts the ones after it.
+ *
+ * Results shorter than `granularity` bytes are not kept: they are cheaper to parse again
+ * than to store, shift and look up.
+ */
+class MemoTable {
+public:
+    struct Entry {
+        size_t offset;
+        size_t rule;
+        size_t consumed;
+        size_t examined;
+        std::shared_ptr<const void> value;
+    };
+
+    explicit MemoTable(size_t granularity = 0)
+        : granularity_(granularity) {}
+
+    static size_t next_rule() {
+        static std::atomic<size_t> rules = 0;
+        return rules++;
+    }
+
+    static MemoTable *current() {
+        return current_;
+    }
+
+    const char *base() const {
+        return base_;
+    }
+
+    const Entry *find(size_t rule, size_t offset) const {
+        auto it = std::lower_bound(entries_.begin(), entries_.end(), std::make_pair(offset, rule),
+                                   [](const Entry &entry, const auto &key) { return std::make_pair(entry.offset, entry.rule) < key; });
+        if (it == entries_.end() || it->offset != offset || it->rule != rule)
+            return nullptr;
+
+        return &*it;
+    }
+
+    void insert(Entry entry) {
+        parsing_++;
+        if (entry.consumed >= granularity_)
+            fresh_.push_back(std::move(entry));
+    }
+
+    // Merges the entries recorded by the last parse.
+    void commit() {
+        auto key = [](const Entry &entry) { return std::make_pair(entry.offset, entry.rule); };
+        std::stable_sort(fresh_.begin(), fresh_.end(), [&](const auto &lhs, const auto &rhs) { return key(lhs) < key(rhs); });
+
+        std::vector<Entry> merged;
+        merged.reserve(entries_.size() + fresh_.size());
+        std::merge(std::make_move_iterator(entries_.begin()), std::make_move_iterator(entries_.end()),
+                   std::make_move_iterator(fresh_.begin()), std::make_move_iterator(fresh_.end()),
+                   std::back_inserter(merged), [&](const auto &lhs, const auto &rhs) { return key(lhs) < key(rhs); });
+
+        auto last = std::unique(merged.rbegin(), merged.rend(), [&](const auto &lhs, const auto &rhs) { return key(lhs) == key(rhs); });
+        merged.erase(merged.begin(), last.base());
+
+        entries_ = std::move(merged);
+        recorded_ = fresh_.size();
+        parsed_ = parsing_;
+        fresh_.clear();
+        parsing_ = 0;
+    }
+
+    // Bytes [offset, offset + removed) were replaced by `inserted` bytes.
+    void edit(size_t offset, size_t removed, size_t inserted) {
+        size_t kept = 0;
+        for (auto &entry: entries_) {
+            if (entry.offset + entry.examined > offset && entry.offset < offset + removed)
+                continue;
+
+            if (entry.offset >= offset + removed)
+                entry.offset = entry.offset - removed + inserted;
+
+            if (&entries_[kept] != &entry)
+                entries_[kept] = std::move(entry);
+
+            kept++;
+        }
+
+        entries_.resize(kept);
+    }
+
+    size_t size() const {
+        return entries_.size();
+    }
+
+    // Entries added to the table by the last parse.
+    size_t recorded() const {
+        return recorded_;
+    }
+
+    // Successful results of `memo` rules that the last parse computed rather than reused,
+    // including those below the granularity that were not added to the table.
+    size_t parsed() const {
+        return parsed_;
+    }
+
+    class Scope {
+    public:
+        Scope(MemoTable &table, StringRef input)
+            : previous_(current_) {
+            table.base_ = input.data();
+            current_ = &table;
+        }
+
+        Scope(const Scope &) = delete;
+        Scope(Scope &&) = delete;
+
+        ~Scope() {
+            current_ = previous_;
+        }
+
+    private:
+        MemoTable *previous_;
+    };
+
+private:
+    static inline thread_local MemoTable *current_ = nullptr;
+
+    size_t granularity_;
+    const char *base_ = nullptr;
+    std::vector<Entry> entries_;
+    std::vector<Entry> fresh_;
+    size_t parsing_ = 0;
+    size_t recorded_ = 0;
+    size_t parsed_ = 0;
+};
+
+/**
+ * Remembers the results of `parser` for `Incremental`; a plain pass-through otherwise.
+ * Hits return a copy of the stored value, so values of memoized rules should be cheap
+ * to copy, e.g. `std::shared_ptr` to an immutable node.
+ */
+template<typename P>
+auto memo(P parser) {
+    using ValueT = typename std::invoke_result_t<P, StringRef &>::value_type;
+
+    return [parser, rule = MemoTable::next_rule()](StringRef &input) -> ParseResult<ValueT> {
+        auto *table = MemoTable::current();
+        auto *context = ParseContext::current();
+        if (!table || !context)
+            return parser(input);
+
+        auto start = reinterpret_cast<std::uintptr_t>(input.data());
+        auto offset = static_cast<size_t>(input.data() - table->base());
+
+        if (const auto *entry = table->find(rule, offset)) {
+            context->examine(start + entry->examined);
+            input.remove_prefix(entry->consumed);
+
+            return *static_cast<const ValueT *>(entry->value.get());
+        }
+
+        auto outer = context->examined();
+        context->set_examined(start);
+
+        const char *before = input.data();
+        auto result = parser(input);
+        auto examined = context->examined() - start;
+        context->examine(outer);
+
+        if (result)
+            table->insert(MemoTable::Entry{offset, rule, static_cast<size_t>(input.data() - before), examined,
+                                           std::make_shared<const ValueT>(result.value())});
+
+        return result;
+    };
+}
+
+/**
+ * Keeps a document and the memoized results of its last parse. After `edit` only the
+ * `memo` rules whose examined bytes overlap the edit are parsed again, everything else
+ * is reused with shifted offsets. A re-parse therefore costs roughly the number of
+ * memoized siblings on the path from the root to the edit.
+ */
+template<typename P>
+class Incremental {
+public:
+    using ValueT = typename std::invoke_result_t<P, StringRef &>::value_type;
+
+    Incremental(P parser, std::string text, size_t granularity = 0)
+        : parser_(std::move(parser)), text_(std::move(text)), memo_(granularity) {}
+
+    ParseResult<ValueT> parse() {
+        ParseContext context(Limits{});
+        ParseContext::Scope context_scope(context);
+        MemoTable::Scope memo_scope(memo_, text_);
+
+        StringRef view(text_);
+        auto result = parser_(view);
+        memo_.commit();
+
+        return result;
+    }
+
+    void edit(size_t offset, size_t removed, StringRef inserted) {
+        text_.replace(offset, removed, inserted);
+        memo_.edit(offset, removed, inserted.size());
+    }
+
+    const std::string &text() const {
+        return text_;
+    }
+
+    const MemoTable &memo() const {
+        return memo_;
+    }
+
+private:
+    P parser_;
+    std::string text_;
+    MemoTable memo_;
+};
+
+}// namespace pc
@@ -0,0 +1,774 @@
+#pragma once
+
+#include "pc/parsecomb/types.h"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// The SSSE3 kernel is compiled regardless of the target flags and picked at run time.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define PC_UTF8_SSSE3 1
+#include <tmmintrin.h>
+#else
+#define PC_UTF8_SSSE3 0
+#endif
+
+namespace pc {
+
+namespace detail {
+
+/**
+ * First `"`, `\` or control character in [position, end). Sets `ascii` when the bytes
+ * before it are all ASCII, so UTF-8 validation of the run can be skipped.
+ */
+inline const char *find_string_special(const char *position, const char *end, bool &ascii) {
+    int high = 0;
+
+#if defined(__SSE2__)
+    const auto quote = _mm_set1_epi8('"');
+    const auto backslash = _mm_set1_epi8('\\');
+    const auto control = _mm_set1_epi8(0x1F);
+
+    for (; end - position >= 16; position += 16) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(position));
+        auto special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                    _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+
+        auto mask = _mm_movemask_epi8(special);
+        if (mask) {
+            auto index = std::countr_zero(static_cast<unsigned>(mask));
+            high |= _mm_movemask_epi8(chunk) & ((1 << index) - 1);
+            ascii = !high;
+
+            return position + index;
+        }
+
+        high |= _mm_movemask_epi8(chunk);
+    }
+#endif
+
+    for (; position != end; position++) {
+        auto ch = static_cast<unsigned char>(*position);
+        if (ch == '"' || ch == '\\' || ch < 0x20)
+            break;
+
+        high |= ch & 0x80;
+    }
+
+    ascii = !high;
+    return position;
+}
+
+// RFC 3629: no overlong forms, no surrogates, nothing above U+10FFFF.
+inline bool valid_utf8_scalar(const char *begin, const char *end) {
+    const auto *position = reinterpret_cast<const unsigned char *>(begin);
+    const auto *last = reinterpret_cast<const unsigned char *>(end);
+
+    while (position != last) {
+        if (*position < 0x80) {
+            position++;
+            continue;
+        }
+
+        auto lead = *position;
+        std::ptrdiff_t size = 0;
+        unsigned char lower = 0x80, upper = 0xBF;
+
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            size = 2;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            size = 3;
+            lower = lead == 0xE0 ? 0xA0 : 0x80;
+            upper = lead == 0xED ? 0x9F : 0xBF;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            size = 4;
+            lower = lead == 0xF0 ? 0x90 : 0x80;
+            upper = lead == 0xF4 ? 0x8F : 0xBF;
+        } else {
+            return false;
+        }
+
+        if (last - position < size || position[1] < lower || position[1] > upper)
+            return false;
+
+        for (std::ptrdiff_t i = 2; i < size; i++) {
+            if ((position[i] & 0xC0) != 0x80)
+                return false;
+        }
+
+        position += size;
+    }
+
+    return true;
+}
+
+#if PC_UTF8_SSSE3
+/**
+ * The same check 16 bytes at a time, after Keiser and Lemire, "Validating UTF-8 In Less Than
+ * One Instruction Per Byte": three nibble lookups classify every pair of adjacent bytes,
+ * the bytes two and three after a lead are checked to be continuations.
+ */
+__attribute__((target("ssse3"))) inline bool valid_utf8_ssse3(const char *begin, const char *end) {
+    constexpr std::uint8_t too_short = 1 << 0;// lead followed by a lead or ASCII
+    constexpr std::uint8_t too_long = 1 << 1; // ASCII followed by a continuation
+    constexpr std::uint8_t overlong_3 = 1 << 2;
+    constexpr std::uint8_t too_large = 1 << 3;
+    constexpr std::uint8_t surrogate = 1 << 4;
+    constexpr std::uint8_t overlong_2 = 1 << 5;
+    constexpr std::uint8_t too_large_1000 = 1 << 6;
+    constexpr std::uint8_t overlong_4 = 1 << 6;
+    constexpr std::uint8_t two_conts = 1 << 7;
+    constexpr std::uint8_t carry = too_short | too_long | two_conts;
+
+    const auto byte_1_high_table = _mm_setr_epi8(
+            too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+            two_conts, two_conts, two_conts, two_conts,
+            too_short | overlong_2, too_short, too_short | overlong_3 | surrogate,
+            static_cast<char>(too_short | too_large | too_large_1000 | overlong_4));
+    const auto byte_1_low_table = _mm_setr_epi8(
+            static_cast<char>(carry | overlong_3 | overlong_2 | overlong_4), static_cast<char>(carry | overlong_2),
+            static_cast<char>(carry), static_cast<char>(carry), static_cast<char>(carry | too_large),
+            static_cast<char>(carry | too_large | too_large_1000), static_cast<char>(carry | too_large | too_large_1000),
+            static_cast<char>(carry | too_large | too_large_1000), static_cast<char>(carry | too_large | too_large_1000),
+            static_cast<char>(carry | too_large | too_large_1000), static_cast<char>(carry | too_large | too_large_1000),
+            static_cast<char>(carry | too_large | too_large_1000), static_cast<char>(carry | too_large | too_large_1000),
+            static_cast<char>(carry | too_large | too_large_1000 | surrogate), static_cast<char>(carry | too_large | too_large_1000),
+            static_cast<char>(carry | too_large | too_large_1000));
+    const auto byte_2_high_table = _mm_setr_epi8(
+            too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+            static_cast<char>(too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4),
+            static_cast<char>(too_long | overlong_2 | two_conts | overlong_3 | too_large),
+            static_cast<char>(too_long | overlong_2 | two_conts | surrogate | too_large),
+            static_cast<char>(too_long | overlong_2 | two_conts | surrogate | too_large),
+            too_short, too_short, too_short, too_short);
+
+    const auto low_nibble = _mm_set1_epi8(0x0F);
+    // Nonzero where a lead in the last three bytes of a block is cut off by the block's end.
+    const auto incomplete_limits = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                 static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1));
+
+    auto error = _mm_setzero_si128();
+    auto previous = _mm_setzero_si128();
+    auto previous_incomplete = _mm_setzero_si128();
+
+    // The last block is zero padded, which also catches sequences cut off by `end`.
+    char tail[16] = {};
+    for (bool last = false; !last;) {
+        __m128i block;
+        if (end - begin >= 16) {
+            block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+            begin += 16;
+        } else {
+            std::memcpy(tail, begin, end - begin);
+            block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tail));
+            last = true;
+        }
+
+        if (!_mm_movemask_epi8(block)) {
+            error = _mm_or_si128(error, previous_incomplete);
+            previous = block;
+            previous_incomplete = _mm_setzero_si128();
+            continue;
+        }
+
+        auto prev1 = _mm_alignr_epi8(block, previous, 15);
+        auto byte_1_high = _mm_shuffle_epi8(byte_1_high_table, _mm_and_si128(_mm_srli_epi16(prev1, 4), low_nibble));
+        auto byte_1_low = _mm_shuffle_epi8(byte_1_low_table, _mm_and_si128(prev1, low_nibble));
+        auto byte_2_high = _mm_shuffle_epi8(byte_2_high_table, _mm_and_si128(_mm_srli_epi16(block, 4), low_nibble));
+        auto special_cases = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+        // Bytes two and three after a lead of a three or four byte sequence must be continuations.
+        auto prev2 = _mm_alignr_epi8(block, previous, 14);
+        auto prev3 = _mm_alignr_epi8(block, previous, 13);
+        auto third = _mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+        auto fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+        auto must_be_continuation = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(static_cast<char>(0x80)));
+
+        error = _mm_or_si128(error, _mm_xor_si128(must_be_continuation, special_cases));
+        previous = block;
+        previous_incomplete = _mm_subs_epu8(block, incomplete_limits);
+    }
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+#endif
+
+inline bool valid_utf8(const char *begin, const char *end) {
+#if PC_UTF8_SSSE3
+    static const bool ssse3 = __builtin_cpu_supports("ssse3");
+    if (ssse3)
+        return valid_utf8_ssse3(begin, end);
+#endif
+
+    return valid_utf8_scalar(begin, end);
+}
+
+inline bool parse_hex4(const char *&position, const char *end, std::uint32_t &code) {
+    if (end - position < 4)
+        return false;
+
+    code = 0;
+    for (int i = 0; i < 4; i++, position++) {
+        auto ch = *position;
+        code <<= 4;
+
+        if (ch >= '0' && ch <= '9')
+            code |= ch - '0';
+        else if (ch >= 'a' && ch <= 'f')
+            code |= ch - 'a' + 10;
+        else if (ch >= 'A' && ch <= 'F')
+            code |= ch - 'A' + 10;
+        else
+            return false;
+    }
+
+    return true;
+}
+
+inline void append_utf8(std::string &result, std::uint32_t code) {
+    if (code < 0x80) {
+        result.push_back(static_cast<char>(code));
+    } else if (code < 0x800) {
+        result.push_back(static_cast<char>(0xC0 | (code >> 6)));
+        result.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+        result.push_back(static_cast<char>(0xE0 | (code >> 12)));
+        result.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        result.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+        result.push_back(static_cast<char>(0xF0 | (code >> 18)));
+        result.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+        result.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        result.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+}
+
+// Decodes the escape following a `\`; surrogate pairs must come as two consecutive `\u` escapes.
+inline bool decode_escape(const char *&position, const char *end, std::string &result) {
+    if (position == end)
+        return false;
+
+    switch (*position++) {
+        case '"': result.push_back('"'); return true;
+        case '\\': result.push_back('\\'); return true;
+        case '/': result.push_back('/'); return true;
+        case 'b': result.push_back('\b'); return true;
+        case 'f': result.push_back('\f'); return true;
+        case 'n': result.push_back('\n'); return true;
+        case 'r': result.push_back('\r'); return true;
+        case 't': result.push_back('\t'); return true;
+        case 'u': break;
+        default: return false;
+    }
+
+    std::uint32_t code;
+    if (!parse_hex4(position, end, code))
+        return false;
+
+    if (code >= 0xDC00 && code <= 0xDFFF)
+        return false;
+
+    if (code >= 0xD800 && code <= 0xDBFF) {
+        std::uint32_t low;
+        if (end - position < 2 || position[0] != '\\' || position[1] != 'u')
+            return false;
+
+        position += 2;
+        if (!parse_hex4(position, end, low) || low < 0xDC00 || low > 0xDFFF)
+            return false;
+
+        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+    }
+
+    append_utf8(result, code);
+    return true;
+}
+
+
+inline const char *skip_whitespace(const char *position, const char *end) {
+    while (position != end && (*position == ' ' || *position == '\n' || *position == '\r' || *position == '\t'))
+        position++;
+
+    return position;
+}
+
+// First `"`, `[`, `]`, `{` or `}` in [position, end).
+inline const char *find_structural(const char *position, const char *end) {
+#if defined(__SSE2__)
+    const auto quote = _mm_set1_epi8('"');
+    const auto open_bracket = _mm_set1_epi8('[');
+    const auto close_bracket = _mm_set1_epi8(']');
+    const auto open_brace = _mm_set1_epi8('{');
+    const auto close_brace = _mm_set1_epi8('}');
+
+    for (; end - position >= 16; position += 16) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(position));
+        auto brackets = _mm_or_si128(_mm_cmpeq_epi8(chunk, open_bracket), _mm_cmpeq_epi8(chunk, close_bracket));
+        auto braces = _mm_or_si128(_mm_cmpeq_epi8(chunk, open_brace), _mm_cmpeq_epi8(chunk, close_brace));
+
+        auto mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_or_si128(brackets, braces)));
+        if (mask)
+            return position + std::countr_zero(static_cast<unsigned>(mask));
+    }
+#endif
+
+    for (; position != end; position++) {
+        auto ch = *position;
+        if (ch == '"' || ch == '[' || ch == ']' || ch == '{' || ch == '}')
+            break;
+    }
+
+    return position;
+}
+
+// Position after the closing quote of the string whose contents start at `position`; nullptr if unterminated.
+inline const char *skip_string(const char *position, const char *end) {
+    for (;;) {
+        bool ascii;
+        const auto *special = find_string_special(position, end, ascii);
+        if (special == end || static_cast<unsigned char>(*special) < 0x20)
+            return nullptr;
+
+        if (*special == '"')
+            return special + 1;
+
+        if (end - special < 2)
+            return nullptr;
+
+        position = special + 2;
+    }
+}
+
+// Kinds of the open brackets of a skipped value, one bit each; spills to the heap past 64 levels.
+class BracketStack {
+public:
+    bool empty() const {
+        return !size_;
+    }
+
+    void push(bool brace) {
+        if (size_ && size_ % 64 == 0) {
+            below_.push_back(top_);
+            top_ = 0;
+        }
+
+        top_ |= std::uint64_t{brace} << (size_ % 64);
+        size_++;
+    }
+
+    // Whether the closed bracket matches the innermost open one.
+    bool pop(bool brace) {
+        if (!size_)
+            return false;
+
+        size_--;
+        auto bit = std::uint64_t{1} << (size_ % 64);
+        bool top_brace = top_ & bit;
+        top_ &= ~bit;
+
+        if (size_ && size_ % 64 == 0) {
+            top_ = below_.back();
+            below_.pop_back();
+        }
+
+        return top_brace == brace;
+    }
+
+private:
+    std::uint64_t top_ = 0;
+    std::vector<std::uint64_t> below_;
+    size_t size_ = 0;
+};
+
+/**
+ * Position after the value starting at `position`, without building it; nullptr if malformed.
+ * Only terminated strings and matching brackets are checked, not the separators and
+ * scalars inside a skipped value.
+ */
+inline const char *skip_value(const char *position, const char *end) {
+    if (position == end)
+        return nullptr;
+
+    if (*position == '"')
+        return skip_string(position + 1, end);
+
+    if (*position == '[' || *position == '{') {
+        BracketStack brackets;
+
+        for (;;) {
+            position = find_structural(position, end);
+            if (position == end)
+                return nullptr;
+
+            switch (*position) {
+                case '"':
+                    position = skip_string(position + 1, end);
+                    if (!position)
+                        return nullptr;
+                    continue;
+                case '[':
+                case '{':
+                    brackets.push(*position == '{');
+                    break;
+                default:
+                    if (!brackets.pop(*position == '}'))
+                        return nullptr;
+
+                    if (brackets.empty())
+                        return position + 1;
+                    break;
+            }
+
+            position++;
+        }
+    }
+
+    const auto *begin = position;
+    while (position != end && *position != ',' && *position != ']' && *position != '}' &&
+           *position != ' ' && *position != '\n' && *position != '\r' && *position != '\t')
+        position++;
+
+    return position == begin ? nullptr : position;
+}
+
+}// namespace detail
+
+/**
+ * JSON string literal as specified by RFC 8259, quotes included: escapes and surrogate
+ * pairs are decoded, raw control characters and malformed UTF-8 are rejected.
+ * Unescaped runs are located with a vectorized scan and copied in bulk.
+ */
+inline auto json_string() {
+    return [](StringRef &input) -> ParseResult<std::string> {
+        ResultBuilder<std::string> guard(input);
+        if (guard.exhausted())
+            return std::unexpected(guard.error());
+
+        guard.examine(1);
+        if (input.empty() || input.front() != '"')
+            return std::unexpected(ParseError::Unknown);
+
+        const char *position = input.data() + 1;
+        const char *end = input.data() + input.size();
+        std::string result;
+
+        for (;;) {
+            bool ascii;
+            const auto *special = detail::find_string_special(position, end, ascii);
+            guard.examine(special - input.data() + 1);
+            if (!ascii && !detail::valid_utf8(position, special))
+                return std::unexpected(ParseError::Unknown);
+
+            result.append(position, special);
+            if (special == end || static_cast<unsigned char>(*special) < 0x20)
+                return std::unexpected(ParseError::Unknown);
+
+            if (*special == '"') {
+                input.remove_prefix(special + 1 - input.data());
+                return guard.build(std::move(result));
+            }
+
+            // The longest escape is a surrogate pair, `\uXXXX\uXXXX`.
+            guard.examine(special - input.data() + 12);
+            position = special + 1;
+            if (!detail::decode_escape(position, end, result))
+                return std::unexpected(ParseError::Unknown);
+        }
+    };
+}
+
+
+namespace detail {
+
+/**
+ * Set of RFC 6901 json pointers merged into a tree, e.g. `/a/b/0` and `/a/c` share `/a`.
+ * `walk` descends only into the members and elements on the way to a pointer and skips
+ * everything else.
+ */
+class JsonSelection {
+public:
+    explicit JsonSelection(const std::vector<StringRef> &pointers)
+        : nodes_(1), size_(pointers.size()) {
+        for (size_t target = 0; target < pointers.size(); target++) {
+            std::vector<std::string> tokens;
+            if (!split(pointers[target], tokens))
+                continue;
+
+            size_t node = 0;
+            for (auto &token: tokens) {
+                if (const auto *child = find_child(node, token)) {
+                    node = child->node;
+                } else {
+                    nodes_[node].children.push_back(Child{token, array_index(token), nodes_.size()});
+                    node = nodes_.size();
+                    nodes_.emplace_back();
+                }
+
+                nodes_[node].subtree.push_back(target);
+            }
+
+            nodes_[node].targets.push_back(target);
+        }
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    // Walks the value at `position` (leading whitespace included) for `node`; returns the position after it.
+    template<typename P, typename ValueT>
+    const char *walk(size_t node, const char *position, const char *end, const P &parser, std::vector<std::optional<ValueT>> &values) const {
+        position = skip_whitespace(position, end);
+
+        if (!nodes_[node].targets.empty()) {
+            StringRef view(position, end - position);
+            auto value = parser(view);
+            if (!value)
+                return nullptr;
+
+            for (auto target: nodes_[node].targets)
+                values[target] = value.value();
+
+            if (nodes_[node].children.empty())
+                return view.data();
+        }
+
+        if (nodes_[node].children.empty() || position == end)
+            return skip_value(position, end);
+
+        if (*position == '{')
+            return walk_object(node, position, end, parser, values);
+
+        if (*position == '[')
+            return walk_array(node, position, end, parser, values);
+
+        return skip_value(position, end);
+    }
+
+private:
+    struct Child {
+        std::string token;
+        size_t index;// InfMany unless the token is an array index
+        size_t node;
+    };
+
+    struct Node {
+        std::vector<size_t> targets;
+        std::vector<Child> children;
+        std::vector<size_t> subtree;// targets of this node and of the nodes below it
+    };
+
+    static bool split(StringRef pointer, std::vector<std::string> &tokens) {
+        if (pointer.empty())
+            return true;
+
+        if (pointer.front() != '/')
+            return false;
+
+        tokens.emplace_back();
+        for (char ch: pointer.substr(1)) {
+            if (ch == '/')
+                tokens.emplace_back();
+            else
+                tokens.back().push_back(ch);
+        }
+
+        for (auto &token: tokens) {
+            std::string unescaped;
+            for (size_t i = 0; i < token.size(); i++) {
+                if (token[i] != '~') {
+                    unescaped.push_back(token[i]);
+                    continue;
+                }
+
+                if (i + 1 == token.size() || (token[i + 1] != '0' && token[i + 1] != '1'))
+                    return false;
+
+                unescaped.push_back(token[++i] == '0' ? '~' : '/');
+            }
+
+            token = std::move(unescaped);
+        }
+
+        return true;
+    }
+
+    static size_t array_index(StringRef token) {
+        if (token.empty() || (token.size() > 1 && token.front() == '0'))
+            return InfMany;
+
+        size_t index = 0;
+        for (char ch: token) {
+            if (ch < '0' || ch > '9')
+                return InfMany;
+
+            index = index * 10 + (ch - '0');
+        }
+
+        return index;
+    }
+
+    const Child *find_child(size_t node, StringRef token) const {
+        for (const auto &child: nodes_[node].children) {
+            if (child.token == token)
+                return &child;
+        }
+
+        return nullptr;
+    }
+
+    const Child *find_element(size_t node, size_t index) const {
+        for (const auto &child: nodes_[node].children) {
+            if (child.index == index)
+                return &child;
+        }
+
+        return nullptr;
+    }
+
+    template<typename P, typename ValueT>
+    const char *walk_object(size_t node, const char *position, const char *end, const P &parser, std::vector<std::optional<ValueT>> &values) const {
+        position = skip_whitespace(position + 1, end);
+        if (position != end && *position == '}')
+            return position + 1;
+
+        for (;;) {
+            if (position == end || *position != '"')
+                return nullptr;
+
+            // Keys without escapes are compared in place, others are decoded first.
+            const Child *child;
+            bool ascii;
+            const auto *quote = find_string_special(position + 1, end, ascii);
+            if (quote != end && *quote == '"') {
+                child = find_child(node, StringRef(position + 1, quote - position - 1));
+                position = quote + 1;
+            } else {
+                StringRef view(position, end - position);
+                auto key = json_string()(view);
+                if (!key)
+                    return nullptr;
+
+                child = find_child(node, StringRef(key.value()));
+                position = view.data();
+            }
+
+            position = skip_whitespace(position, end);
+            if (position == end || *position != ':')
+                return nullptr;
+
+            // A later duplicate key replaces the whole member, including what was found below it.
+            if (child) {
+                for (auto target: nodes_[child->node].subtree)
+                    values[target].reset();
+
+                position = walk(child->node, position + 1, end, parser, values);
+            } else {
+                position = skip_value(skip_whitespace(position + 1, end), end);
+            }
+
+            if (!position)
+                return nullptr;
+
+            position = skip_whitespace(position, end);
+            if (position == end)
+                return nullptr;
+
+            if (*position == '}')
+                return position + 1;
+
+            if (*position != ',')
+                return nullptr;
+
+            position = skip_whitespace(position + 1, end);
+        }
+    }
+
+    template<typename P, typename ValueT>
+    const char *walk_array(size_t node, const char *position, const char *end, const P &parser, std::vector<std::optional<ValueT>> &values) const {
+        position = skip_whitespace(position + 1, end);
+        if (position != end && *position == ']')
+            return position + 1;
+
+        for (size_t index = 0;; index++) {
+            if (const auto *child = find_element(node, index))
+                position = walk(child->node, position, end, parser, values);
+            else
+                position = skip_value(position, end);
+
+            if (!position)
+                return nullptr;
+
+            position = skip_whitespace(position, end);
+            if (position == end)
+                return nullptr;
+
+            if (*position == ']')
+                return position + 1;
+
+            if (*position != ',')
+                return nullptr;
+
+            position = skip_whitespace(position + 1, end);
+        }
+    }
+
+    std::vector<Node> nodes_;
+    size_t size_;
+};
+
+}// namespace detail
+
+/**
+ * Values at the given json pointers (RFC 6901), e.g. `json_select({"/a/b/0", "/c"}, parser)`.
+ * Only the selected values are built, with `parser`; everything else is skipped by scanning
+ * for quotes and brackets. Returns one entry per pointer, in order, empty when the document
+ * has no such value or the pointer is malformed. On duplicate keys the last one wins, also
+ * for pointers that go through the key, as in a fully built `std::map`.
+ * Like json's `element`, consumes the whitespace around the document.
+ */
+template<typename P>
+auto json_select(const std::vector<StringRef> &pointers, P parser) {
+    using ValueT = typename std::invoke_result_t<P, StringRef &>::value_type;
+    using ResultT = std::vector<std::optional<ValueT>>;
+
+    auto selection = std::make_shared<const detail::JsonSelection>(pointers);
+
+    return [selection, parser](StringRef &input) -> ParseResult<ResultT> {
+        ResultBuilder<ResultT> guard(input);
+        if (guard.exhausted())
+            return std::unexpected(guard.error());
+
+        ResultT values(selection->size());
+        const char *end = input.data() + input.size();
+        const auto *after = selection->walk(0, input.data(), end, parser, values);
+        if (!after) {
+            guard.examine(input.size() + 1);
+            return std::unexpected(ParseError::Unknown);
+        }
+
+        after = detail::skip_whitespace(after, end);
+        guard.examine(after - input.data() + 1);
+        input.remove_prefix(after - input.data());
+
+        return guard.build(std::move(values));
+    };
+}
+
+template<typename P>
+auto json_select(std::initializer_list<StringRef> pointers, P parser) {
+    return json_select(std::vector<StringRef>(pointers), std::move(parser));
+}
+
+}// namespace pc
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "pc/parsecomb/types.h"
+#include "pc/parsecomb/units.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace pc {
+
+/**
+ * Radix trie over a fixed set of keywords, laid out in flat arrays.
+ * Edge labels are compared a word at a time, children are found by scanning
+ * the contiguous first bytes of their labels.
+ */
+class KeywordTrie {
+public:
+    struct Match {
+        size_t index;
+        size_t size;
+    };
+
+    explicit KeywordTrie(const std::vector<StringRef> &keywords) {
+        std::vector<std::uint32_t> order(keywords.size());
+        for (std::uint32_t i = 0; i < order.size(); i++)
+            order[i] = i;
+
+        std::stable_sort(order.begin(), order.end(), [&](auto lhs, auto rhs) { return keywords[lhs] < keywords[rhs]; });
+
+        std::vector<StringRef> sorted;
+        for (auto i: order)
+            sorted.push_back(keywords[i]);
+
+        build(sorted, order, 0, sorted.size(), 0);
+
+        for (auto keyword: keywords)
+            longest_ = std::max(longest_, keyword.size());
+    }
+
+    size_t longest() const {
+        return longest_;
+    }
+
+    // Longest keyword that is a prefix of `input`.
+    std::optional<Match> match(StringRef input) const {
+        std::optional<Match> best;
+        const auto *node = &nodes_.back();
+        size_t position = 0;
+
+        for (;;) {
+            if (input.size() - position < node->label_size ||
+                !equal_words(input.data() + position, labels_.data() + node->label, node->label_size))
+                break;
+
+            position += node->label_size;
+            if (node->keyword != NoKeyword)
+                best = Match{node->keyword, position};
+
+            if (position == input.size() || !node->child_count)
+                break;
+
+            const auto *first = first_bytes_.data() + node->children;
+            const auto *found = static_cast<const char *>(std::memchr(first, input[position], node->child_count));
+            if (!found)
+                break;
+
+            node = &nodes_[child_nodes_[node->children + (found - first)]];
+        }
+
+        return best;
+    }
+
+private:
+    static constexpr std::uint32_t NoKeyword = ~std::uint32_t{0};
+
+    struct Node {
+        std::uint32_t label;
+        std::uint32_t label_size;
+        std::uint32_t children;
+        std::uint32_t child_count;
+        std::uint32_t keyword;
+    };
+
+    // Builds the node for sorted keywords [lo, hi) sharing their first `depth` bytes; returns its index.
+    std::uint32_t build(const std::vector<StringRef> &sorted, const std::vector<std::uint32_t> &order,
+                        size_t lo, size_t hi, size_t depth) {
+        Node node{static_cast<std::uint32_t>(labels_.size()), 0, 0, 0, NoKeyword};
+
+        if (lo < hi) {
+            auto first = sorted[lo];
+            auto last = sorted[hi - 1];
+            auto common = depth;
+            while (common < first.size() && common < last.size() && first[common] == last[common])
+                common++;
+
+            labels_.append(first.substr(depth, common - depth));
+            node.label_size = static_cast<std::uint32_t>(common - depth);
+            depth = common;
+        }
+
+        for (; lo < hi && sorted[lo].size() == depth; lo++) {
+            if (node.keyword == NoKeyword)
+                node.keyword = order[lo];
+        }
+
+        std::string first_bytes;
+        std::vector<std::uint32_t> children;
+        while (lo < hi) {
+            auto group_end = lo;
+            while (group_end < hi && sorted[group_end][depth] == sorted[lo][depth])
+                group_end++;
+
+            first_bytes.push_back(sorted[lo][depth]);
+            children.push_back(build(sorted, order, lo, group_end, depth));
+            lo = group_end;
+        }
+
+        node.children = static_cast<std::uint32_t>(child_nodes_.size());
+        node.child_count = static_cast<std::uint32_t>(children.size());
+        first_bytes_ += first_bytes;
+        child_nodes_.insert(child_nodes_.end(), children.begin(), children.end());
+
+        nodes_.push_back(node);
+        return static_cast<std::uint32_t>(nodes_.size() - 1);
+    }
+
+    std::string labels_;
+    std::string first_bytes_;
+    std::vector<std::uint32_t> child_nodes_;
+    std::vector<Node> nodes_;
+    size_t longest_ = 0;
+};
+
+/**
+ * Longest-match alternative of literals, e.g. `one_of_tags({"true", "false", "null"})`.
+ * Returns the index of the matched keyword in the given list; on duplicates the first one wins.
+ */
+inline auto one_of_tags(const std::vector<StringRef> &keywords) {
+    auto trie = std::make_shared<const KeywordTrie>(keywords);
+
+    return [trie](StringRef &input) -> ParseResult<size_t> {
+        ResultBuilder<size_t> guard(input);
+        if (guard.exhausted())
+            return std::unexpected(guard.error());
+
+        guard.examine(trie->longest() + 1);
+        auto match = trie->match(input);
+        if (!match)
+            return std::unexpected(ParseError::Unknown);
+
+        input.remove_prefix(match->size);
+
+        return guard.build(match->index);
+    };
+}
+
+inline auto one_of_tags(std::initializer_list<StringRef> keywords) {
+    return one_of_tags(std::vector<StringRef>(keywords));
+}
+
+}// namespace pc
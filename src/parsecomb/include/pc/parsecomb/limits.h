@@ -0,0 +1,58 @@
+#pragma once
+
+#include "pc/parsecomb/types.h"
+
+#include <type_traits>
+
+namespace pc {
+
+/**
+ * Runs `parser` under a fresh `ParseContext`. When any of the limits is hit the
+ * whole parse fails with the corresponding `ParseError` and the input is restored.
+ * See `Limits::max_steps` for how steps are counted by each engine.
+ */
+template<typename P>
+auto with_limits(P parser, Limits limits) {
+    using ValueT = typename std::invoke_result_t<P, StringRef &>::value_type;
+
+    return [parser, limits](StringRef &input) -> ParseResult<ValueT> {
+        ParseContext context(limits);
+        ParseContext::Scope scope(context);
+        ResultBuilder<ValueT> guard(input);
+
+        auto result = parser(input);
+        if (context.exhausted())
+            return std::unexpected(context.error());
+
+        PC_EXPECT_ASSIGN(value, std::move(result));
+
+        return guard.build(std::move(value));
+    };
+}
+
+/**
+ * Marks a recursion point of a grammar, e.g. `object` and `array` in json.
+ * Each active `nested` parser on the call stack counts towards `Limits::max_depth`.
+ */
+template<typename P>
+auto nested(P parser) {
+    using ValueT = typename std::invoke_result_t<P, StringRef &>::value_type;
+
+    return [parser](StringRef &input) -> ParseResult<ValueT> {
+        auto *context = ParseContext::current();
+        if (!context)
+            return parser(input);
+
+        if (!context->enter()) {
+            context->leave();
+            return std::unexpected(context->error());
+        }
+
+        auto result = parser(input);
+        context->leave();
+
+        return result;
+    };
+}
+
+}// namespace pc
@@ -0,0 +1,345 @@
+#pragma once
+
+#include "pc/parsecomb/types.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Non-recursive execution engine. Patterns are built with the same vocabulary as the
+ * closure combinators, linked by `Grammar` into one flat instruction sequence and run
+ * by `Program` on a heap-allocated stack, so nesting depth is bounded only by memory.
+ *
+ * Instead of building values the program records `Capture` events (`capture` spans),
+ * which are turned into values by the caller.
+ */
+namespace pc::vm {
+
+enum class Op : std::uint8_t {
+    Range,
+    Choice,
+    Commit,
+    PartialCommit,
+    Fail,
+    Call,
+    Return,
+    Open,
+    Close,
+    Enter,
+    Leave,
+    End,
+};
+
+// Jump targets are relative to the instruction itself, so patterns can be concatenated freely.
+struct Instruction {
+    Op op;
+    char from = 0;
+    char to = 0;
+    std::int32_t arg = 0;
+};
+
+struct Pattern {
+    std::vector<Instruction> code;
+};
+
+enum class CaptureEvent : std::uint8_t {
+    Open,
+    Close,
+};
+
+struct Capture {
+    CaptureEvent event;
+    std::uint32_t kind;
+    std::size_t offset;
+};
+
+using Captures = std::vector<Capture>;
+
+inline auto size(const Pattern &pattern) {
+    return static_cast<std::int32_t>(pattern.code.size());
+}
+
+inline Pattern char_range(char from, char to) {
+    return Pattern{{Instruction{Op::Range, from, to}}};
+}
+
+inline Pattern chr(char ch) {
+    return char_range(ch, ch);
+}
+
+inline Pattern tag(StringRef item) {
+    Pattern result;
+    for (char ch: item)
+        result.code.push_back(Instruction{Op::Range, ch, ch});
+
+    return result;
+}
+
+inline Pattern seq(Pattern pattern) {
+    return pattern;
+}
+
+template<typename... Tail>
+Pattern seq(Pattern head, Tail... tail) {
+    auto rest = seq(std::move(tail)...);
+    head.code.insert(head.code.end(), rest.code.begin(), rest.code.end());
+
+    return head;
+}
+
+inline Pattern alt(Pattern pattern) {
+    return pattern;
+}
+
+template<typename... Tail>
+Pattern alt(Pattern head, Tail... tail) {
+    auto rest = alt(std::move(tail)...);
+
+    Pattern result;
+    result.code.push_back(Instruction{Op::Choice, 0, 0, size(head) + 2});
+    result.code.insert(result.code.end(), head.code.begin(), head.code.end());
+    result.code.push_back(Instruction{Op::Commit, 0, 0, size(rest) + 1});
+    result.code.insert(result.code.end(), rest.code.begin(), rest.code.end());
+
+    return result;
+}
+
+inline Pattern maybe(Pattern pattern) {
+    Pattern result;
+    result.code.push_back(Instruction{Op::Choice, 0, 0, size(pattern) + 2});
+    result.code.insert(result.code.end(), pattern.code.begin(), pattern.code.end());
+    result.code.push_back(Instruction{Op::Commit, 0, 0, 1});
+
+    return result;
+}
+
+inline Pattern many_any(Pattern pattern) {
+    Pattern result;
+    result.code.push_back(Instruction{Op::Choice, 0, 0, size(pattern) + 2});
+    result.code.insert(result.code.end(), pattern.code.begin(), pattern.code.end());
+    result.code.push_back(Instruction{Op::PartialCommit, 0, 0, -size(pattern)});
+
+    return result;
+}
+
+inline Pattern many_more(size_t lower, Pattern pattern) {
+    Pattern result;
+    for (size_t i = 0; i < lower; i++)
+        result.code.insert(result.code.end(), pattern.code.begin(), pattern.code.end());
+
+    return seq(std::move(result), many_any(std::move(pattern)));
+}
+
+inline Pattern many_any_separated_by(Pattern pattern, Pattern separator) {
+    return seq(pattern, many_any(seq(std::move(separator), pattern)));
+}
+
+template<typename Kind>
+Pattern capture(Kind kind, Pattern pattern) {
+    auto id = static_cast<std::int32_t>(kind);
+
+    return seq(Pattern{{Instruction{Op::Open, 0, 0, id}}},
+               std::move(pattern),
+               Pattern{{Instruction{Op::Close, 0, 0, id}}});
+}
+
+// Recursion point counted towards `Limits::max_depth`, like `pc::nested` in closure grammars.
+inline Pattern nested(Pattern pattern) {
+    return seq(Pattern{{Instruction{Op::Enter}}}, std::move(pattern), Pattern{{Instruction{Op::Leave}}});
+}
+
+// Call of a rule defined in the enclosing `Grammar`, possibly recursively.
+template<typename Id>
+Pattern rule(Id id) {
+    return Pattern{{Instruction{Op::Call, 0, 0, static_cast<std::int32_t>(id)}}};
+}
+
+class Program {
+public:
+    explicit Program(std::vector<Instruction> code)
+        : code_(std::move(code)) {}
+
+    /**
+     * Runs the program against `input`. Honors the limits of an active `ParseContext`:
+     * every instruction is a step, every active `nested` pattern a nesting level.
+     */
+    ParseResult<Captures> operator()(StringRef &input) const {
+        struct Frame {
+            std::int32_t ip;
+            const char *position;
+            size_t captures;// InfMany for return frames
+            size_t depth;
+        };
+
+        std::vector<Frame> stack;
+        Captures captures;
+        auto *context = ParseContext::current();
+
+        const char *begin = input.data();
+        const char *end = begin + input.size();
+        const char *position = begin;
+        const char *furthest = begin;
+        std::int32_t ip = 0;
+        size_t depth = 0;
+
+        for (;;) {
+            if (context) {
+                context->step();
+                if (context->exhausted())
+                    return std::unexpected(context->error());
+            }
+
+            const auto &instruction = code_[ip];
+            switch (instruction.op) {
+                case Op::Range:
+                    if (position != end && *position >= instruction.from && *position <= instruction.to) {
+                        position++;
+                        ip++;
+                        continue;
+                    }
+                    break;
+                case Op::Choice:
+                    stack.push_back(Frame{ip + instruction.arg, position, captures.size(), depth});
+                    ip++;
+                    continue;
+                case Op::Commit:
+                    stack.pop_back();
+                    ip += instruction.arg;
+                    continue;
+                case Op::PartialCommit:
+                    stack.back().position = position;
+                    stack.back().captures = captures.size();
+                    ip += instruction.arg;
+                    continue;
+                case Op::Fail:
+                    break;
+                case Op::Call:
+                    stack.push_back(Frame{ip + 1, position, InfMany, depth});
+                    ip += instruction.arg;
+                    continue;
+                case Op::Return:
+                    ip = stack.back().ip;
+                    stack.pop_back();
+                    continue;
+                case Op::Open:
+                    captures.push_back(Capture{CaptureEvent::Open, static_cast<std::uint32_t>(instruction.arg), static_cast<size_t>(position - begin)});
+                    ip++;
+                    continue;
+                case Op::Close:
+                    captures.push_back(Capture{CaptureEvent::Close, static_cast<std::uint32_t>(instruction.arg), static_cast<size_t>(position - begin)});
+                    ip++;
+                    continue;
+                case Op::Enter:
+                    if (context && !context->enter())
+                        return std::unexpected(context->error());
+
+                    depth++;
+                    ip++;
+                    continue;
+                case Op::Leave:
+                    if (context)
+                        context->leave();
+
+                    depth--;
+                    ip++;
+                    continue;
+                case Op::End:
+                    if (context)
+                        context->examine(reinterpret_cast<std::uintptr_t>(std::max(furthest, position)) + 1);
+
+                    input.remove_prefix(position - begin);
+                    return captures;
+            }
+
+            while (!stack.empty() && stack.back().captures == InfMany)
+                stack.pop_back();
+
+            // Backtracking leaves the `nested` patterns entered since the choice point.
+            auto target = stack.empty() ? 0 : stack.back().depth;
+            for (; depth > target; depth--) {
+                if (context)
+                    context->leave();
+            }
+
+            // Every failure looked at the byte under `position` at most.
+            furthest = std::max(furthest, position);
+            if (stack.empty()) {
+                if (context)
+                    context->examine(reinterpret_cast<std::uintptr_t>(furthest) + 1);
+
+                return std::unexpected(ParseError::Unknown);
+            }
+
+            auto frame = stack.back();
+            stack.pop_back();
+
+            if (context)
+                context->backtrack(position - frame.position);
+
+            ip = frame.ip;
+            position = frame.position;
+            captures.resize(frame.captures);
+        }
+    }
+
+    const std::vector<Instruction> &code() const {
+        return code_;
+    }
+
+private:
+    std::vector<Instruction> code_;
+};
+
+/**
+ * Set of mutually recursive rules. `compile` lays out every rule body followed by
+ * a return and resolves `rule` calls; calls of undefined rules never match.
+ */
+class Grammar {
+public:
+    template<typename Id>
+    void define(Id id, Pattern body) {
+        auto index = static_cast<size_t>(id);
+        if (rules_.size() <= index)
+            rules_.resize(index + 1);
+
+        rules_[index] = std::move(body);
+        defined_.resize(rules_.size());
+        defined_[index] = true;
+    }
+
+    template<typename Id>
+    Program compile(Id start) const {
+        std::vector<Instruction> code;
+        code.push_back(Instruction{Op::Call, 0, 0, static_cast<std::int32_t>(start)});
+        code.push_back(Instruction{Op::End});
+
+        std::vector<std::int32_t> addresses;
+        for (const auto &body: rules_) {
+            addresses.push_back(static_cast<std::int32_t>(code.size()));
+            code.insert(code.end(), body.code.begin(), body.code.end());
+            code.push_back(Instruction{Op::Return});
+        }
+
+        for (size_t ip = 0; ip < code.size(); ip++) {
+            auto &instruction = code[ip];
+            if (instruction.op != Op::Call)
+                continue;
+
+            auto index = static_cast<size_t>(instruction.arg);
+            if (index < defined_.size() && defined_[index])
+                instruction.arg = addresses[index] - static_cast<std::int32_t>(ip);
+            else
+                instruction = Instruction{Op::Fail};
+        }
+
+        return Program(std::move(code));
+    }
+
+private:
+    std::vector<Pattern> rules_;
+    std::vector<bool> defined_;
+};
+
+}// namespace pc::vm
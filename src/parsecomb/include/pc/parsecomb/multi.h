@@ -13,14 +13,13 @@ namespace pc {
 template<typename T, typename F>
 using Aggregator = std::tuple<T, F>;
 
-// Add perfect forwarding
 template<typename T>
-using VectorAggregator = std::tuple<std::vector<T>, decltype([](auto& acc, auto&& x) { acc.push_back(x); })>;
+using VectorAggregator = std::tuple<std::vector<T>, decltype([](auto& acc, auto&& x) { acc.push_back(std::forward<decltype(x)>(x)); })>;
 
 using StringAggregator = std::tuple<std::string, decltype([](auto& acc, auto&& x) { acc.push_back(x); })>;
 
 template<typename K, typename V>
-using TupleToMapAggregator = std::tuple<std::map<K, V>, decltype([](auto& acc, auto&& x) { acc[std::get<0>(x)] = std::get<1>(x); })>;
+using TupleToMapAggregator = std::tuple<std::map<K, V>, decltype([](auto& acc, auto&& x) { acc[std::get<0>(std::forward<decltype(x)>(x))] = std::get<1>(std::forward<decltype(x)>(x)); })>;
 
 template<typename P, typename T, typename F>
 auto fold_many_lower_upper(size_t lower, size_t upper, P parser, Aggregator<T, F> aggregator) {
@@ -32,7 +31,7 @@ auto fold_many_lower_upper(size_t lower, size_t upper, P parser, Aggregator<T, F
         for (; i < upper; i++) {
             auto one_more = parser(input);
             if (one_more)
-                std::get<1>(aggregator)(result, one_more.value());
+                std::get<1>(aggregator)(result, std::move(one_more).value());
             else
                 break;
         }
@@ -81,13 +80,18 @@ template<typename P, typename S, typename T, typename F>
 auto fold_any_separated_by(P parser, S separator, Aggregator<T, F> aggregator) {
     return [parser, separator, aggregator](StringRef &input) -> ParseResult<T> {
         ResultBuilder<T> guard(input);
+        auto result = std::get<0>(aggregator);
 
-        PC_EXPECT_ASSIGN(prefix, fold_many_any(pc::take<0>(parser, separator), aggregator)(input));
-        PC_EXPECT_ASSIGN(suffix, parser(input));
+        PC_EXPECT_ASSIGN(head, parser(input));
+        std::get<1>(aggregator)(result, std::move(head));
 
-        std::get<F>(aggregator)(prefix, suffix);
+        // Each item is parsed once. A separator that is not followed by an item fails the whole list.
+        while (separator(input)) {
+            PC_EXPECT_ASSIGN(item, parser(input));
+            std::get<1>(aggregator)(result, std::move(item));
+        }
 
-        return guard.build(std::move(prefix));
+        return guard.build(std::move(result));
     };
 }
 
@@ -24,12 +24,13 @@ auto tuple(HeadP p_head, TailPs... p_tail) {
     using ValueT = std::tuple<typename std::invoke_result_t<HeadP, StringRef &>::value_type,
                               typename std::invoke_result_t<TailPs, StringRef &>::value_type...>;
 
-    return [p_head, p_tail...](StringRef &input) -> ParseResult<ValueT> {
+    // The sequence of the tail is built once here rather than on every call.
+    return [p_head, p_rest = tuple(p_tail...)](StringRef &input) -> ParseResult<ValueT> {
         ResultBuilder<ValueT> guard(input);
 
         return p_head(input).and_then([&](auto head_value) -> ParseResult<ValueT> {
-            return tuple(p_tail...)(input).transform([&](auto tail_value) {
-                return guard.build(std::tuple_cat(std::make_tuple(head_value), tail_value));
+            return p_rest(input).transform([&](auto tail_value) {
+                return guard.build(std::tuple_cat(std::make_tuple(std::move(head_value)), std::move(tail_value)));
             });
         });
     };
@@ -37,12 +38,20 @@ auto tuple(HeadP p_head, TailPs... p_tail) {
 
 template<std::size_t Idx, typename... Parsers>
 auto take(Parsers... parsers) {
-    return map(tuple(parsers...), [](const auto& tp) { return std::get<Idx>(tp); });
+    return map(tuple(parsers...), [](auto&& tp) { return std::get<Idx>(std::move(tp)); });
 }
 
 template<std::size_t Idx1, std::size_t Idx2, typename... Parsers>
 auto take(Parsers... parsers) {
-    return map(tuple(parsers...), [](const auto& tp) { return std::make_tuple(std::get<Idx1>(tp), std::get<Idx2>(tp)); });
+    return map(tuple(parsers...), [](auto&& tp) {
+        // With equal indices the second copy is taken before the first is moved from.
+        if constexpr (Idx1 == Idx2) {
+            auto second = std::get<Idx2>(tp);
+            return std::make_tuple(std::get<Idx1>(std::move(tp)), std::move(second));
+        } else {
+            return std::make_tuple(std::get<Idx1>(std::move(tp)), std::get<Idx2>(std::move(tp)));
+        }
+    });
 }
 
 }// namespace pc
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <expected>
 #include <limits>
 #include <string_view>
@@ -31,22 +33,165 @@ constexpr size_t InfMany = std::numeric_limits<size_t>::max();
 
 enum class ParseError {
     Unknown,
+    DepthLimitExceeded,
+    StepLimitExceeded,
+    BacktrackLimitExceeded,
 };
 
 template<typename T>
 using ParseResult = std::expected<T, ParseError>;
 
+struct Limits {
+    size_t max_depth = InfMany;
+    // A step is a parser invocation (`ResultBuilder`) in closure grammars and an instruction
+    // in `vm::Program`. The counts differ, but stay within a factor of two of each other on json.
+    size_t max_steps = InfMany;
+    size_t max_backtrack = InfMany;
+};
+
+/**
+ * Per-parse execution budget. Installed for the current thread by `pc::with_limits`,
+ * charged by every `ResultBuilder` and checked by `pc::nested` and the unit parsers.
+ * Once a limit is hit the context stays exhausted and all further parsing fails fast.
+ *
+ * The unit parsers also report how far ahead they looked (`examine`), which is what
+ * `pc::memo` needs to know which results an edit of the input invalidates.
+ */
+class ParseContext {
+public:
+    explicit ParseContext(Limits limits)
+        : limits_(limits) {}
+
+    ParseContext(const ParseContext &) = delete;
+    ParseContext(ParseContext &&) = delete;
+
+    static ParseContext *current() {
+        return current_;
+    }
+
+    bool exhausted() const {
+        return exhausted_;
+    }
+
+    ParseError error() const {
+        return error_;
+    }
+
+    size_t steps() const {
+        return steps_;
+    }
+
+    void step() {
+        if (++steps_ > limits_.max_steps)
+            exhaust(ParseError::StepLimitExceeded);
+    }
+
+    void backtrack(size_t bytes) {
+        backtracked_ += bytes;
+        if (backtracked_ > limits_.max_backtrack)
+            exhaust(ParseError::BacktrackLimitExceeded);
+    }
+
+    bool enter() {
+        if (++depth_ > limits_.max_depth)
+            exhaust(ParseError::DepthLimitExceeded);
+
+        return !exhausted_;
+    }
+
+    void leave() {
+        depth_--;
+    }
+
+    // Addresses rather than pointers: looking ahead may reach past the end of the input.
+    std::uintptr_t examined() const {
+        return examined_;
+    }
+
+    void examine(std::uintptr_t address) {
+        examined_ = std::max(examined_, address);
+    }
+
+    void set_examined(std::uintptr_t address) {
+        examined_ = address;
+    }
+
+    class Scope {
+    public:
+        explicit Scope(ParseContext &context)
+            : previous_(current_) {
+            current_ = &context;
+        }
+
+        Scope(const Scope &) = delete;
+        Scope(Scope &&) = delete;
+
+        ~Scope() {
+            if (previous_ && current_->examined_)
+                previous_->examine(current_->examined_);
+
+            current_ = previous_;
+        }
+
+    private:
+        ParseContext *previous_;
+    };
+
+private:
+    void exhaust(ParseError error) {
+        if (!exhausted_)
+            error_ = error;
+
+        exhausted_ = true;
+    }
+
+    static inline thread_local ParseContext *current_ = nullptr;
+
+    Limits limits_;
+    size_t depth_ = 0;
+    size_t steps_ = 0;
+    size_t backtracked_ = 0;
+    std::uintptr_t examined_ = 0;
+    bool exhausted_ = false;
+    ParseError error_ = ParseError::Unknown;
+};
+
 template<typename T>
 struct ResultBuilder {
     ResultBuilder(StringRef &view)
-        : view_(view), original_(view) {}
+        : view_(view), original_(view), context_(ParseContext::current()) {
+        if (context_)
+            context_->step();
+    }
 
     ResultBuilder(const ResultBuilder &) = delete;
     ResultBuilder(ResultBuilder &&) = delete;
 
     ~ResultBuilder() {
-        if (!parsed_)
+        if (!parsed_) {
+            if (context_)
+                context_->backtrack(consumed());
+
             view_ = original_;
+        }
+    }
+
+    bool exhausted() const {
+        return context_ && context_->exhausted();
+    }
+
+    ParseError error() const {
+        return context_ ? context_->error() : ParseError::Unknown;
+    }
+
+    size_t consumed() const {
+        return original_.size() - view_.size();
+    }
+
+    // The parser looked at `size` bytes from where it started, one past the end counts as looking at the end.
+    void examine(size_t size) {
+        if (context_)
+            context_->examine(reinterpret_cast<std::uintptr_t>(original_.data()) + size);
     }
 
     /* unsafe */
@@ -65,5 +210,6 @@ struct ResultBuilder {
 
     StringRef &view_;
     StringRef original_;
+    ParseContext *context_;
 };
 }// namespace pc
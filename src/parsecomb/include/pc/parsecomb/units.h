@@ -2,6 +2,8 @@
 
 #include "pc/parsecomb/types.h"
 #include "pc/parsecomb/traits.h"
+#include <cstdint>
+#include <cstring>
 #include <tuple>
 #include <type_traits>
 
@@ -10,6 +12,10 @@ namespace pc {
 inline auto char_range(char from, char to) {
     return [from, to](StringRef &input) -> ParseResult<char> {
         ResultBuilder<char> guard(input);
+        if (guard.exhausted())
+            return std::unexpected(guard.error());
+
+        guard.examine(1);
         if (input.empty())
             return std::unexpected(ParseError::Unknown);
 
@@ -27,21 +33,40 @@ inline auto chr(char ch) {
     return char_range(ch, ch);
 }
 
+// Compares `size` bytes a machine word at a time.
+inline bool equal_words(const char *lhs, const char *rhs, size_t size) {
+    for (; size >= sizeof(std::uint64_t); size -= sizeof(std::uint64_t)) {
+        std::uint64_t lhs_word, rhs_word;
+        std::memcpy(&lhs_word, lhs, sizeof(std::uint64_t));
+        std::memcpy(&rhs_word, rhs, sizeof(std::uint64_t));
+        if (lhs_word != rhs_word)
+            return false;
+
+        lhs += sizeof(std::uint64_t);
+        rhs += sizeof(std::uint64_t);
+    }
+
+    if (!size)
+        return true;
+
+    std::uint64_t lhs_word = 0, rhs_word = 0;
+    std::memcpy(&lhs_word, lhs, size);
+    std::memcpy(&rhs_word, rhs, size);
+
+    return lhs_word == rhs_word;
+}
+
 inline auto tag(StringRef item) {
     return [item](StringRef &input) -> ParseResult<NothingT> {
-        auto item_copy = item;
         ResultBuilder<NothingT> guard(input);
+        if (guard.exhausted())
+            return std::unexpected(guard.error());
 
-        if (input.size() < item_copy.size())
+        guard.examine(item.size());
+        if (input.size() < item.size() || !equal_words(input.data(), item.data(), item.size()))
             return std::unexpected(ParseError::Unknown);
 
-        while (!item_copy.empty() && input.front() == item_copy.front()) {
-            input.remove_prefix(1);
-            item_copy.remove_prefix(1);
-        }
-
-        if (!item_copy.empty())
-            return std::unexpected(ParseError::Unknown);
+        input.remove_prefix(item.size());
 
         return guard.build(Nothing);
     };
@@ -51,17 +76,23 @@ inline auto tag(StringRef item) {
 inline auto spaces(size_t n) {
     return [n](StringRef &input) -> ParseResult<NothingT> {
         ResultBuilder<NothingT> guard(input);
+        if (guard.exhausted())
+            return std::unexpected(guard.error());
+
         auto n_copy = n;
-        if (input.size() < n_copy)
+        if (input.size() < n_copy) {
+            guard.examine(input.size() + 1);
             return std::unexpected(ParseError::Unknown);
+        }
 
-        while (std::isspace(input.front())) {
+        while (!input.empty() && std::isspace(input.front())) {
             input.remove_prefix(1);
 
             if (n_copy)
                 n_copy--;
         }
 
+        guard.examine(guard.consumed() + 1);
         if (n_copy)
             return std::unexpected(ParseError::Unknown);
 
@@ -72,7 +103,10 @@ inline auto spaces(size_t n) {
 inline auto int32() {
     return [](StringRef &input) -> ParseResult<std::int32_t> {
         ResultBuilder<std::int32_t> guard(input);
+        if (guard.exhausted())
+            return std::unexpected(guard.error());
 
+        guard.examine(1);
         if (input.empty())
             return std::unexpected(ParseError::Unknown);
 
@@ -83,15 +117,18 @@ inline auto int32() {
         }
 
         std::int32_t value = 0;
-        if (input.empty() || !std::isdigit(input.front()))
+        if (input.empty() || !std::isdigit(input.front())) {
+            guard.examine(guard.consumed() + 1);
             return std::unexpected(ParseError::Unknown);
+        }
 
-        while (std::isdigit(input.front())) {
+        while (!input.empty() && std::isdigit(input.front())) {
             value *= 10;
             value += input.front() - '0';
             input.remove_prefix(1);
         }
 
+        guard.examine(guard.consumed() + 1);
         return guard.build(value * sign);
     };
 }
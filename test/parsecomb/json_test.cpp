@@ -1,109 +1,17 @@
-#include <cstddef>
-#include <cstdint>
 #include <gtest/gtest.h>
-#include <optional>
+#include <random>
 #include <string>
-#include <unordered_map>
-#include <variant>
 #include <vector>
 
-#include "pc/parsecomb/branch.h"
-#include "pc/parsecomb/functional.h"
-#include "pc/parsecomb/multi.h"
-#include "pc/parsecomb/sequence.h"
-#include "pc/parsecomb/traits.h"
+#include "pc/parsecomb/incremental.h"
+#include "pc/parsecomb/json.h"
+#include "pc/parsecomb/limits.h"
+#include "pc/parsecomb/machine.h"
 #include "pc/parsecomb/types.h"
-#include "pc/parsecomb/units.h"
 
+#include "utils/jsgrammar.h"
 #include "utils/jsutils.h"
 
-namespace js {
-struct Value;
-
-using String = std::string;
-using Char = char;
-using Number = std::int32_t;
-using Array = std::vector<Value>;
-using Object = std::map<std::string, Value>;
-
-using Variant = std::variant<
-        String,
-        Number,
-        Object,
-        Array>;
-
-struct Value : public Variant {
-    using variant::variant;
-};
-
-Value to_value(const Variant &var) {
-    return std::visit([](auto &&arg) -> Value { return arg; }, var);
-}
-
-using Json = Value;
-
-namespace parser {
-const auto ws = pc::chr(' ') | pc::chr('\n') | pc::chr('\t');
-const auto wss = many_any(ws);
-const auto character = ws | pc::char_range('a', 'z') | pc::char_range('A', 'Z') | pc::char_range('0', '9');
-const auto number = pc::int32();
-const auto string = take<1>(pc::chr('"'), fold_many_any(character, pc::StringAggregator{}), pc::chr('"'));
-
-pc::ParseResult<Object> object(pc::StringRef &input);
-pc::ParseResult<Array> array(pc::StringRef &input);
-
-const auto value = alt(string, number, object, array);
-
-/**
- * From `json.org`:
- * array
- *    '[' ws ']'
- *    '[' elements ']'
- *
- * elements
- *    element
- *    element ',' elements
- *
- * element
- *    ws value ws
- */
-const auto element = map(take<1>(wss, value, wss), to_value);
-const auto elements = many_any_separated_by(element, pc::chr(','));
-
-const auto empty_array = to(take<1>(pc::chr('['), wss, pc::chr(']')), Array{});
-const auto non_empty_array = take<1>(pc::chr('['), elements, pc::chr(']'));
-
-pc::ParseResult<Array> array(pc::StringRef &input) {
-    return alt(empty_array, non_empty_array)(input);
-}
-
-/**
- * From `json.org`:
- * object
- *     '{' ws '}'
- *     '{' members '}'
- *
- * members
- *     member
- *     member ',' members
- *
- * member
- *     ws string ws ':' element
- */
-const auto member = pc::take<0, 2>(pc::take<1>(wss, string, wss), pc::chr(':'), element);
-const auto members = fold_any_separated_by(member, pc::chr(','), pc::TupleToMapAggregator<std::string, Value>{});
-
-const auto empty_object = to(take<1>(pc::chr('{'), wss, pc::chr('}')), Object{});
-const auto non_empty_object = take<1>(pc::chr('{'), members, pc::chr('}'));
-
-pc::ParseResult<Object> object(pc::StringRef &input) {
-    return alt(empty_object, non_empty_object)(input);
-}
-
-const auto json = element;
-}// namespace parser
-}// namespace js
-
 
 TEST(JsonParser, BaseJsonParser) {
     std::string input = R"({
@@ -127,3 +35,430 @@ TEST(JsonParser, BaseJsonParser) {
 
     EXPECT_TRUE(are_equal);
 }
+
+TEST(JsonParser, DepthLimit) {
+    std::string input = std::string(100000, '[') + std::string(100000, ']');
+    pc::StringRef view(input);
+    auto result = pc::with_limits(js::parser::json, pc::Limits{.max_depth = 64})(view);
+
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), pc::ParseError::DepthLimitExceeded);
+    EXPECT_EQ(view.size(), input.size());
+}
+
+TEST(JsonParser, StepLimit) {
+    std::string input = R"([1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16])";
+    pc::StringRef view(input);
+    auto result = pc::with_limits(js::parser::json, pc::Limits{.max_steps = 100})(view);
+
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), pc::ParseError::StepLimitExceeded);
+    EXPECT_EQ(view.size(), input.size());
+}
+
+TEST(JsonParser, BacktrackLimit) {
+    std::string input = R"([[1], [2], [3], [4], [5], [6], [7], [8]])";
+    pc::StringRef view(input);
+    auto result = pc::with_limits(js::parser::json, pc::Limits{.max_backtrack = 4})(view);
+
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), pc::ParseError::BacktrackLimitExceeded);
+}
+
+TEST(JsonParser, WithinLimits) {
+    std::string input = R"({"a": {"b": {"c": [1, 2, 3, "unknown"]}}})";
+    pc::StringRef view(input);
+    auto result = pc::with_limits(js::parser::json, pc::Limits{.max_depth = 4, .max_steps = 10000, .max_backtrack = 1000})(view);
+
+    ASSERT_TRUE(result.has_value());
+    EXPECT_TRUE(view.empty());
+}
+
+TEST(JsonMachine, SameAsClosureEngine) {
+    std::string input = R"({
+    "Empire State Building": {
+        "height": 1250,
+        "floors": 102,
+        "meta": [1, 13, -223, "unknown", {}, [ ]]
+    }
+})";
+    pc::StringRef closure_view(input);
+    auto expected = js::parser::json(closure_view);
+    ASSERT_TRUE(expected.has_value());
+
+    pc::StringRef view(input);
+    auto captures = js::machine::json()(view);
+    ASSERT_TRUE(captures.has_value());
+    EXPECT_TRUE(view.empty());
+
+    auto result = js::machine::from_captures(input, captures.value());
+    ASSERT_TRUE(result.has_value());
+    EXPECT_TRUE(js::equal(result.value(), expected.value()));
+}
+
+TEST(JsonMachine, DeepNesting) {
+    constexpr size_t depth = 100000;
+    std::string input = std::string(depth, '[') + "1" + std::string(depth, ']');
+    pc::StringRef view(input);
+    auto captures = js::machine::json()(view);
+
+    ASSERT_TRUE(captures.has_value());
+    EXPECT_EQ(captures.value().size(), 2 * depth + 2);
+    EXPECT_TRUE(view.empty());
+}
+
+TEST(JsonMachine, DepthLimit) {
+    std::string input = std::string(100000, '[') + std::string(100000, ']');
+    pc::StringRef view(input);
+    auto result = pc::with_limits(js::machine::json(), pc::Limits{.max_depth = 64})(view);
+
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), pc::ParseError::DepthLimitExceeded);
+    EXPECT_EQ(view.size(), input.size());
+}
+
+TEST(JsonMachine, SameDepthAsClosureEngine) {
+    // Five levels: object, array, array, object, array.
+    std::string input = R"({"a": [[1, {"b": []}], 2]})";
+
+    for (size_t max_depth: {4, 5}) {
+        pc::StringRef closure_view(input);
+        auto closure = pc::with_limits(js::parser::json, pc::Limits{.max_depth = max_depth})(closure_view);
+
+        pc::StringRef machine_view(input);
+        auto machine = pc::with_limits(js::machine::json(), pc::Limits{.max_depth = max_depth})(machine_view);
+
+        EXPECT_EQ(closure.has_value(), max_depth == 5);
+        EXPECT_EQ(machine.has_value(), max_depth == 5);
+        if (!machine) {
+            EXPECT_EQ(machine.error(), pc::ParseError::DepthLimitExceeded);
+        }
+    }
+}
+
+TEST(JsonMachine, StepsComparableToClosureEngine) {
+    std::string input = R"({"a": {"b": [1, 22, "x"]}, "c": [[1], [2]]})";
+
+    pc::ParseContext closure(pc::Limits{});
+    {
+        pc::ParseContext::Scope scope(closure);
+        pc::StringRef view(input);
+        ASSERT_TRUE(js::parser::json(view).has_value());
+    }
+
+    pc::ParseContext machine(pc::Limits{});
+    {
+        pc::ParseContext::Scope scope(machine);
+        pc::StringRef view(input);
+        ASSERT_TRUE(js::machine::json()(view).has_value());
+    }
+
+    // One step per parser invocation against one per instruction: not equal, but within a
+    // factor of two of each other, so one `max_steps` budget means roughly the same work.
+    EXPECT_LT(machine.steps(), 2 * closure.steps());
+    EXPECT_LT(closure.steps(), 2 * machine.steps());
+}
+
+TEST(JsonMachine, Invalid) {
+    std::string input = R"({"a": [1, 2,]})";
+    pc::StringRef view(input);
+    auto captures = js::machine::json()(view);
+
+    EXPECT_FALSE(captures.has_value());
+    EXPECT_EQ(view.size(), input.size());
+}
+
+static pc::ParseResult<std::string> parse_string(const std::string &input) {
+    pc::StringRef view(input);
+    return pc::json_string()(view);
+}
+
+TEST(JsonString, Plain) {
+    EXPECT_EQ(parse_string(R"("")").value(), "");
+    EXPECT_EQ(parse_string(R"("Empire State Building, 1250 ft")").value(), "Empire State Building, 1250 ft");
+
+    std::string long_text(1000, 'x');
+    EXPECT_EQ(parse_string('"' + long_text + '"').value(), long_text);
+}
+
+TEST(JsonString, Escapes) {
+    EXPECT_EQ(parse_string(R"("a\"b\\c\/d\b\f\n\r\t")").value(), "a\"b\\c/d\b\f\n\r\t");
+    EXPECT_EQ(parse_string(R"("\u0041\u00e9\u20AC")").value(), "A\xC3\xA9\xE2\x82\xAC");
+    EXPECT_EQ(parse_string(R"("clef \uD834\uDD1E!")").value(), "clef \xF0\x9D\x84\x9E!");
+}
+
+TEST(JsonString, Multibyte) {
+    std::string text = "na\xC3\xAFve caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80 and some more ASCII after it";
+    EXPECT_EQ(parse_string('"' + text + '"').value(), text);
+}
+
+TEST(JsonString, Invalid) {
+    EXPECT_FALSE(parse_string(R"("unterminated)").has_value());
+    EXPECT_FALSE(parse_string("\"raw\nnewline\"").has_value());
+    EXPECT_FALSE(parse_string(R"("bad \x escape")").has_value());
+    EXPECT_FALSE(parse_string(R"("short \u12")").has_value());
+    EXPECT_FALSE(parse_string(R"("lone \uD834 surrogate")").has_value());
+    EXPECT_FALSE(parse_string(R"("lone \uDD1E surrogate")").has_value());
+    EXPECT_FALSE(parse_string("\"overlong \xC0\xAF\"").has_value());
+    EXPECT_FALSE(parse_string("\"surrogate \xED\xA0\x80\"").has_value());
+    EXPECT_FALSE(parse_string("\"truncated \xE2\x82\"").has_value());
+    EXPECT_FALSE(parse_string("\"too large \xF4\x90\x80\x80\"").has_value());
+}
+
+TEST(JsonString, Utf8KernelsAgree) {
+    const std::vector<std::string> pieces = {"a", "0123456789abcdef", "\xC3\xA9", "\xE2\x82\xAC", "\xED\x9F\xBF", "\xF0\x9F\x98\x80",
+                                             "\xF4\x8F\xBF\xBF", "\xC0\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\x80", "\xE2\x82", "\xFF"};
+    std::mt19937 random(0);
+
+    for (size_t i = 0; i < 100000; i++) {
+        std::string text;
+        auto count = random() % 24;
+        for (size_t j = 0; j < count; j++)
+            text += pieces[random() % pieces.size()];
+
+        // Occasionally cut a sequence anywhere.
+        if (random() % 4 == 0 && !text.empty())
+            text.resize(random() % text.size());
+
+        ASSERT_EQ(pc::detail::valid_utf8(text.data(), text.data() + text.size()),
+                  pc::detail::valid_utf8_scalar(text.data(), text.data() + text.size()))
+                << testing::PrintToString(text);
+    }
+}
+
+TEST(JsonString, LeavesRest) {
+    std::string input = R"("key": 1)";
+    pc::StringRef view(input);
+
+    EXPECT_EQ(pc::json_string()(view).value(), "key");
+    EXPECT_EQ(view, ": 1");
+}
+
+TEST(JsonParser, EscapedStrings) {
+    std::string input = R"({"naïve": ["tab\there", "quote\"d"]})";
+    pc::StringRef view(input);
+    auto result = js::parser::json(view);
+
+    ASSERT_TRUE(result.has_value());
+    EXPECT_TRUE(js::equal(result.value(), js::Object{{"na\xC3\xAFve", js::Array{js::String{"tab\there"}, js::String{"quote\"d"}}}}));
+
+    pc::StringRef machine_view(input);
+    auto captures = js::machine::json()(machine_view);
+    ASSERT_TRUE(captures.has_value());
+    EXPECT_TRUE(js::equal(js::machine::from_captures(input, captures.value()).value(), result.value()));
+}
+
+TEST(JsonParser, InvalidStringsOnBothEngines) {
+    for (std::string input: {R"(["\uD800"])", "[\"overlong \xC0\xAF\"]", "[\"truncated \xE2\x82\"]"}) {
+        pc::StringRef view(input);
+        EXPECT_FALSE(js::parser::json(view).has_value()) << input;
+
+        pc::StringRef machine_view(input);
+        auto captures = js::machine::json()(machine_view);
+        ASSERT_TRUE(captures.has_value()) << input;
+        EXPECT_FALSE(js::machine::from_captures(input, captures.value()).has_value()) << input;
+    }
+}
+
+TEST(JsonIncremental, SameAsFullParse) {
+    std::string input = R"({"a": {"b": [1, 2, 3], "c": "text"}, "d": [{"e": 4}, {"f": 5}]})";
+    pc::Incremental document(js::incremental::parser::json, input);
+    ASSERT_TRUE(document.parse().has_value());
+
+    struct Edit {
+        std::string anchor;
+        size_t removed;
+        std::string inserted;
+    };
+
+    std::vector<Edit> edits = {
+            {"2", 1, "42"},
+            {"]", 0, ", 7"},
+            {"ext", 2, ""},
+            {"\"f\"", 3, "\"g\""},
+            {"}]}", 2, "}, {\"h\": []}]"},
+            {"a", 1, "z"},
+    };
+
+    for (const auto &edit: edits) {
+        document.edit(document.text().find(edit.anchor), edit.removed, edit.inserted);
+        auto result = document.parse();
+        ASSERT_TRUE(result.has_value()) << document.text();
+
+        pc::StringRef view(document.text());
+        auto expected = js::parser::json(view);
+        ASSERT_TRUE(expected.has_value());
+        EXPECT_TRUE(js::equal(js::incremental::to_value(result.value()), expected.value())) << document.text();
+    }
+}
+
+TEST(JsonIncremental, BrokenAndFixed) {
+    std::string input = R"({"a": [1, 2, 3], "b": {"c": 4}})";
+    pc::Incremental document(js::incremental::parser::json, input);
+    ASSERT_TRUE(document.parse().has_value());
+
+    auto colon = input.find(':');
+    document.edit(colon, 1, "");
+    EXPECT_FALSE(document.parse().has_value());
+
+    document.edit(colon, 0, ":");
+    auto result = document.parse();
+    ASSERT_TRUE(result.has_value());
+
+    pc::StringRef view(input);
+    EXPECT_TRUE(js::equal(js::incremental::to_value(result.value()), js::parser::json(view).value()));
+}
+
+TEST(JsonIncremental, ReusesUntouchedRules) {
+    std::string input = "[";
+    for (size_t i = 0; i < 100; i++)
+        input += (i ? ", " : "") + std::string(R"({"id": )") + std::to_string(1000 + i) + R"(, "tags": [1, 2]})";
+    input += "]";
+
+    pc::Incremental document(js::incremental::parser::json, input);
+    ASSERT_TRUE(document.parse().has_value());
+    EXPECT_EQ(document.memo().recorded(), 201);
+    EXPECT_EQ(document.memo().parsed(), 201);
+
+    document.edit(input.find("1050") + 3, 1, "7");
+    auto result = document.parse();
+    ASSERT_TRUE(result.has_value());
+
+    // The edited object and the enclosing array.
+    EXPECT_EQ(document.memo().recorded(), 2);
+    EXPECT_EQ(document.memo().parsed(), 2);
+    EXPECT_EQ(document.memo().size(), 201);
+
+    const auto &array = std::get<js::incremental::Array>(*result.value());
+    const auto &object = std::get<js::incremental::Object>(*array[50]);
+    EXPECT_EQ(std::get<js::Number>(*object.at("id")), 1057);
+}
+
+TEST(JsonIncremental, Granularity) {
+    std::string input = "[";
+    for (size_t i = 0; i < 100; i++)
+        input += (i ? ", " : "") + std::string(R"({"id": )") + std::to_string(1000 + i) + R"(, "tags": [1, 2]})";
+    input += "]";
+
+    // Objects are shorter than 64 bytes and are parsed again instead of being kept.
+    pc::Incremental document(js::incremental::parser::json, input, 64);
+    ASSERT_TRUE(document.parse().has_value());
+    EXPECT_EQ(document.memo().size(), 1);
+    EXPECT_EQ(document.memo().recorded(), 1);
+    EXPECT_EQ(document.memo().parsed(), 201);
+
+    // The only kept entry spans the edit, so everything is parsed again.
+    document.edit(input.find("1050") + 3, 1, "7");
+    auto result = document.parse();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(document.memo().recorded(), 1);
+    EXPECT_EQ(document.memo().parsed(), 201);
+
+    pc::StringRef view(document.text());
+    EXPECT_TRUE(js::equal(js::incremental::to_value(result.value()), js::parser::json(view).value()));
+}
+
+TEST(JsonSelect, SelectedPaths) {
+    std::string input = R"( {
+    "Empire State Building": {
+        "height": 1250,
+        "floors": 102,
+        "meta": [1, 13, -223, "unknown"]
+    },
+    "skipped": {"a": [[], {}, "]}\"[{"], "b": -0.5e3, "c": true, "d": null}
+} )";
+    pc::StringRef view(input);
+
+    auto select = pc::json_select({"/Empire State Building/height", "/Empire State Building/meta/3", "/Empire State Building/meta",
+                                   "/missing", "/Empire State Building/meta/4", "/Empire State Building/height/0"},
+                                  js::parser::json);
+    auto result = select(view).value();
+
+    ASSERT_EQ(result.size(), 6);
+    EXPECT_TRUE(js::equal(result[0].value(), js::Number{1250}));
+    EXPECT_TRUE(js::equal(result[1].value(), js::String{"unknown"}));
+    EXPECT_TRUE(js::equal(result[2].value(), js::Array{js::Number{1}, js::Number{13}, js::Number{-223}, js::String{"unknown"}}));
+    EXPECT_FALSE(result[3].has_value());
+    EXPECT_FALSE(result[4].has_value());
+    EXPECT_FALSE(result[5].has_value());
+    EXPECT_TRUE(view.empty());
+}
+
+TEST(JsonSelect, PointerSyntax) {
+    std::string input = R"({"a/b": 1, "m~n": 2, "": 3, "A": 4, "0": 5, "list": [6, 7], "k": 8, "k": 9})";
+
+    auto select = pc::json_select({"/a~1b", "/m~0n", "/", "/A", "/0", "/list/1", "/list/01", "/list/-", "/k", "a", "/m~2n"},
+                                  pc::int32());
+    pc::StringRef view(input);
+    auto result = select(view).value();
+
+    EXPECT_EQ(result[0], 1);
+    EXPECT_EQ(result[1], 2);
+    EXPECT_EQ(result[2], 3);
+    EXPECT_EQ(result[3], 4);
+    EXPECT_EQ(result[4], 5);
+    EXPECT_EQ(result[5], 7);
+    EXPECT_FALSE(result[6].has_value());
+    EXPECT_FALSE(result[7].has_value());
+    EXPECT_EQ(result[8], 9);
+    EXPECT_FALSE(result[9].has_value());
+    EXPECT_FALSE(result[10].has_value());
+
+    // The empty pointer selects the whole document, which is not a number.
+    pc::StringRef root_as_number_view(input);
+    EXPECT_FALSE(pc::json_select({""}, pc::int32())(root_as_number_view).has_value());
+
+    pc::StringRef root_view(input);
+    auto root = pc::json_select({""}, js::parser::json)(root_view).value();
+
+    pc::StringRef reference_view(input);
+    EXPECT_TRUE(js::equal(root[0].value(), js::parser::json(reference_view).value()));
+}
+
+TEST(JsonSelect, DuplicateKeys) {
+    auto select = pc::json_select({"/k", "/k/x"}, js::parser::json);
+
+    std::string object_first = R"({"k": {"x": 1}, "k": 2})";
+    pc::StringRef object_first_view(object_first);
+    auto replaced = select(object_first_view).value();
+
+    EXPECT_TRUE(js::equal(replaced[0].value(), js::Number{2}));
+    EXPECT_FALSE(replaced[1].has_value());
+
+    std::string object_last = R"({"k": 2, "k": {"x": 1}})";
+    pc::StringRef object_last_view(object_last);
+    auto kept = select(object_last_view).value();
+
+    EXPECT_TRUE(js::equal(kept[0].value(), js::Object{{"x", js::Number{1}}}));
+    EXPECT_TRUE(js::equal(kept[1].value(), js::Number{1}));
+}
+
+TEST(JsonSelect, SkipsDeepValues) {
+    std::string deep;
+    for (size_t i = 0; i < 200; i++)
+        deep += i % 3 ? "[" : "{\"k\": ";
+    for (size_t i = 200; i-- > 0;)
+        deep += i % 3 ? "]" : "}";
+
+    std::string input = R"({"a": )" + deep + R"(, "b": 1})";
+    pc::StringRef view(input);
+    auto result = pc::json_select({"/b"}, pc::int32())(view);
+
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value()[0], 1);
+}
+
+TEST(JsonSelect, Malformed) {
+    auto select = pc::json_select({"/b"}, js::parser::json);
+
+    std::vector<std::string> inputs = {R"({"a": "unterminated, "b": 1)", R"({"a": [1, 2, "b": 1})", R"({"a" 1, "b": 2})",
+                                       R"({"a": 1 "b": 2})", R"({"b": [1, 2})", R"({"a": "raw
+newline", "b": 1})", R"({"a": [1, 2}, "b": 1})", R"({"a": {"k": [1}], "b": 1})", R"({"a": {"k": 1]], "b": 1})",
+                                       R"({"a": [)" + std::string(100, '[') + "}" + std::string(100, ']') + R"(, "b": 1})"};
+
+    for (const auto &input: inputs) {
+        pc::StringRef view(input);
+        EXPECT_FALSE(select(view).has_value()) << input;
+        EXPECT_EQ(view.size(), input.size());
+    }
+}
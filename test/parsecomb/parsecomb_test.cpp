@@ -1,8 +1,10 @@
+#include <algorithm>
 #include <gtest/gtest.h>
 #include <variant>
 #include <vector>
 
 #include "pc/parsecomb/branch.h"
+#include "pc/parsecomb/keywords.h"
 #include "pc/parsecomb/multi.h"
 #include "pc/parsecomb/sequence.h"
 #include "pc/parsecomb/types.h"
@@ -192,3 +194,142 @@ TEST(SimpleParsing, PointEasyAltDifferentType) {
         EXPECT_TRUE(std::holds_alternative<Circle>(result2));
     }
 }
+
+TEST(Keywords, LongestMatch) {
+    auto keyword = pc::one_of_tags({"in", "integer", "int", "if", "else"});
+    std::string input = "integer int in if elsewhere";
+    pc::StringRef view(input);
+
+    auto separated = pc::take<0>(keyword, pc::spaces(0));
+    auto result = pc::many_any(separated)(view).value();
+
+    EXPECT_EQ(result, (std::vector<size_t>{1, 2, 0, 3, 4}));
+    EXPECT_EQ(view, "where");
+}
+
+TEST(Keywords, NoMatch) {
+    auto keyword = pc::one_of_tags({"true", "false", "null"});
+    std::string input = "nul";
+    pc::StringRef view(input);
+
+    EXPECT_FALSE(keyword(view).has_value());
+    EXPECT_EQ(view.size(), input.size());
+}
+
+TEST(Keywords, SameAsAlt) {
+    std::vector<std::string> words;
+    for (size_t i = 0; i < 300; i++)
+        words.push_back("kw" + std::to_string(i * 7919 % 1000));
+    words.push_back(words[42]);
+
+    std::vector<pc::StringRef> keywords(words.begin(), words.end());
+    auto keyword = pc::one_of_tags(keywords);
+
+    // What an alt over the tags would do once they are ordered longest first, ties in list order.
+    std::vector<size_t> order(words.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&words](size_t lhs, size_t rhs) {
+        return words[lhs].size() > words[rhs].size();
+    });
+
+    auto tags_alt = [&order, &keywords](pc::StringRef &input) -> pc::ParseResult<size_t> {
+        for (size_t index: order) {
+            if (pc::tag(keywords[index])(input))
+                return index;
+        }
+
+        return std::unexpected(pc::ParseError::Unknown);
+    };
+
+    std::vector<std::string> inputs = {"", "k", "kx", "zz"};
+    for (const auto &word: words) {
+        inputs.push_back(word);
+        inputs.push_back(word.substr(0, word.size() - 1));
+        inputs.push_back(word + "0");
+        inputs.push_back(word + "x");
+    }
+
+    for (const auto &input: inputs) {
+        pc::StringRef expected_view(input);
+        pc::StringRef view(input);
+
+        auto expected = tags_alt(expected_view);
+        auto result = keyword(view);
+
+        ASSERT_EQ(result.has_value(), expected.has_value()) << input;
+        if (expected) {
+            EXPECT_EQ(result.value(), expected.value()) << input;
+        }
+        EXPECT_EQ(view, expected_view) << input;
+    }
+
+    pc::StringRef duplicate(words[42]);
+    EXPECT_EQ(keyword(duplicate).value(), 42u);
+}
+
+template<typename P>
+concept Referenceable = requires(P &&parser) { pc::ref(std::forward<P>(parser)); };
+
+static_assert(Referenceable<const decltype(pc::chr(' ')) &>);
+static_assert(!Referenceable<decltype(pc::chr(' '))>);
+
+TEST(Sharing, RefAndShare) {
+    const auto blanks = pc::spaces(0);
+    auto number = pc::take<1>(pc::ref(blanks), pc::int32(), pc::ref(blanks));
+    auto numbers = pc::many_any(pc::share(number));
+
+    EXPECT_LT(sizeof(pc::ref(blanks)), sizeof(pc::many_any(pc::chr(' '))));
+    EXPECT_EQ(sizeof(pc::share(numbers)), sizeof(std::shared_ptr<const void>));
+
+    std::string input = " 1  -2 3 x";
+    pc::StringRef view(input);
+
+    EXPECT_EQ(numbers(view).value(), (std::vector<std::int32_t>{1, -2, 3}));
+    EXPECT_EQ(view, "x");
+}
+
+TEST(Sequence, TakeSameIndexTwice) {
+    std::string input = "word!";
+    pc::StringRef view(input);
+    auto word = pc::fold_many_more(1, pc::char_range('a', 'z'), pc::StringAggregator{});
+
+    auto result = pc::take<0, 0>(word, pc::chr('!'))(view).value();
+
+    EXPECT_EQ(std::get<0>(result), "word");
+    EXPECT_EQ(std::get<1>(result), "word");
+}
+
+TEST(Multi, SeparatedList) {
+    std::string input = "1,2";
+    pc::StringRef view(input);
+
+    EXPECT_EQ(pc::many_any_separated_by(pc::int32(), pc::chr(','))(view).value(), (std::vector<std::int32_t>{1, 2}));
+    EXPECT_TRUE(view.empty());
+}
+
+TEST(Multi, SeparatedListTrailingSeparator) {
+    std::string input = "1,2,";
+    pc::StringRef view(input);
+
+    EXPECT_FALSE(pc::many_any_separated_by(pc::int32(), pc::chr(','))(view));
+    EXPECT_EQ(view, "1,2,");
+}
+
+TEST(Multi, SeparatedListParsesEachItemOnce) {
+    constexpr size_t count = 10000;
+    std::string input = "0";
+    for (size_t i = 1; i < count; i++)
+        input += ",0";
+
+    size_t calls = 0;
+    auto item = [&calls](pc::StringRef &view) {
+        calls++;
+        return pc::int32()(view);
+    };
+
+    pc::StringRef view(input);
+    EXPECT_EQ(pc::many_any_separated_by(item, pc::chr(','))(view).value().size(), count);
+    EXPECT_TRUE(view.empty());
+    EXPECT_EQ(calls, count);
+}
@@ -0,0 +1,326 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "pc/parsecomb/branch.h"
+#include "pc/parsecomb/functional.h"
+#include "pc/parsecomb/incremental.h"
+#include "pc/parsecomb/json.h"
+#include "pc/parsecomb/limits.h"
+#include "pc/parsecomb/machine.h"
+#include "pc/parsecomb/multi.h"
+#include "pc/parsecomb/sequence.h"
+#include "pc/parsecomb/types.h"
+#include "pc/parsecomb/units.h"
+
+namespace js {
+struct Value;
+
+using String = std::string;
+using Char = char;
+using Number = std::int32_t;
+using Array = std::vector<Value>;
+using Object = std::map<std::string, Value>;
+
+using Variant = std::variant<
+        String,
+        Number,
+        Object,
+        Array>;
+
+struct Value : public Variant {
+    using variant::variant;
+};
+
+inline Value to_value(Variant var) {
+    return std::visit([](auto &&arg) -> Value { return std::move(arg); }, std::move(var));
+}
+
+using Json = Value;
+
+/**
+ * Rules used in several places are referenced with `pc::ref` rather than copied, and
+ * `object` and `array` call rules built once rather than on every call, so no rule is
+ * nested by value in more than one other.
+ */
+namespace parser {
+const auto ws = pc::chr(' ') | pc::chr('\n') | pc::chr('\t');
+const auto wss = many_any(ws);
+const auto number = pc::int32();
+const auto string = pc::json_string();
+
+inline pc::ParseResult<Object> object(pc::StringRef &input);
+inline pc::ParseResult<Array> array(pc::StringRef &input);
+
+const auto value = alt(string, number, pc::nested(object), pc::nested(array));
+
+/**
+ * From `json.org`:
+ * array
+ *    '[' ws ']'
+ *    '[' elements ']'
+ *
+ * elements
+ *    element
+ *    element ',' elements
+ *
+ * element
+ *    ws value ws
+ */
+const auto element = map(take<1>(pc::ref(wss), value, pc::ref(wss)), to_value);
+const auto elements = many_any_separated_by(pc::ref(element), pc::chr(','));
+
+const auto empty_array = to(take<1>(pc::chr('['), pc::ref(wss), pc::chr(']')), Array{});
+const auto non_empty_array = take<1>(pc::chr('['), elements, pc::chr(']'));
+const auto any_array = alt(empty_array, non_empty_array);
+
+inline pc::ParseResult<Array> array(pc::StringRef &input) {
+    return any_array(input);
+}
+
+/**
+ * From `json.org`:
+ * object
+ *     '{' ws '}'
+ *     '{' members '}'
+ *
+ * members
+ *     member
+ *     member ',' members
+ *
+ * member
+ *     ws string ws ':' element
+ */
+const auto member = pc::take<0, 2>(pc::take<1>(pc::ref(wss), string, pc::ref(wss)), pc::chr(':'), pc::ref(element));
+const auto members = fold_any_separated_by(member, pc::chr(','), pc::TupleToMapAggregator<std::string, Value>{});
+
+const auto empty_object = to(take<1>(pc::chr('{'), pc::ref(wss), pc::chr('}')), Object{});
+const auto non_empty_object = take<1>(pc::chr('{'), members, pc::chr('}'));
+const auto any_object = alt(empty_object, non_empty_object);
+
+inline pc::ParseResult<Object> object(pc::StringRef &input) {
+    return any_object(input);
+}
+
+const auto json = element;
+
+// Bytes a parse of `json` reaches: `json` itself plus the rules it only reaches through
+// `pc::ref` or the `object`/`array` functions. Every other rule is nested by value in one of these.
+inline size_t footprint() {
+    return sizeof(json) + sizeof(wss) + sizeof(element) + sizeof(any_array) + sizeof(any_object);
+}
+}// namespace parser
+
+/**
+ * The same grammar over immutable shared nodes with `object` and `array` memoized,
+ * for `pc::Incremental`: rules reused after an edit copy a pointer, not a subtree.
+ */
+namespace incremental {
+struct Node;
+
+using NodePtr = std::shared_ptr<const Node>;
+using Array = std::vector<NodePtr>;
+using Object = std::map<std::string, NodePtr>;
+
+using NodeVariant = std::variant<
+        String,
+        Number,
+        Object,
+        Array>;
+
+struct Node : public NodeVariant {
+    using variant::variant;
+};
+
+inline Value to_value(const NodePtr &node) {
+    return std::visit([](const auto &arg) -> Value {
+        using T = std::decay_t<decltype(arg)>;
+
+        if constexpr (std::is_same_v<T, Array>) {
+            js::Array result;
+            for (const auto &item: arg)
+                result.push_back(to_value(item));
+
+            return result;
+        } else if constexpr (std::is_same_v<T, Object>) {
+            js::Object result;
+            for (const auto &[key, item]: arg)
+                result[key] = to_value(item);
+
+            return result;
+        } else {
+            return arg;
+        }
+    },
+                      static_cast<const NodeVariant &>(*node));
+}
+
+namespace parser {
+using js::parser::number;
+using js::parser::string;
+using js::parser::wss;
+
+inline pc::ParseResult<NodePtr> object(pc::StringRef &input);
+inline pc::ParseResult<NodePtr> array(pc::StringRef &input);
+
+const auto leaf = map(alt(string, number), [](const auto &var) {
+    return std::visit([](const auto &arg) { return std::make_shared<const Node>(arg); }, var);
+});
+const auto value = alt(leaf, pc::memo(object), pc::memo(array));
+
+const auto element = take<1>(pc::ref(wss), value, pc::ref(wss));
+const auto elements = many_any_separated_by(pc::ref(element), pc::chr(','));
+
+const auto empty_array = to(take<1>(pc::chr('['), pc::ref(wss), pc::chr(']')), Array{});
+const auto non_empty_array = take<1>(pc::chr('['), elements, pc::chr(']'));
+const auto any_array = alt(empty_array, non_empty_array);
+
+inline pc::ParseResult<NodePtr> array(pc::StringRef &input) {
+    PC_EXPECT_ASSIGN(result, any_array(input));
+
+    return std::make_shared<const Node>(std::move(result));
+}
+
+const auto member = pc::take<0, 2>(pc::take<1>(pc::ref(wss), string, pc::ref(wss)), pc::chr(':'), pc::ref(element));
+const auto members = fold_any_separated_by(member, pc::chr(','), pc::TupleToMapAggregator<std::string, NodePtr>{});
+
+const auto empty_object = to(take<1>(pc::chr('{'), pc::ref(wss), pc::chr('}')), Object{});
+const auto non_empty_object = take<1>(pc::chr('{'), members, pc::chr('}'));
+const auto any_object = alt(empty_object, non_empty_object);
+
+inline pc::ParseResult<NodePtr> object(pc::StringRef &input) {
+    PC_EXPECT_ASSIGN(result, any_object(input));
+
+    return std::make_shared<const Node>(std::move(result));
+}
+
+const auto json = element;
+}// namespace parser
+}// namespace incremental
+
+/**
+ * The same grammar for the explicit-stack engine. The program only records captures,
+ * `from_captures` turns them into a `Json` without recursion; strings are decoded
+ * (and their UTF-8 validated) by `pc::json_string`, which fails the whole conversion
+ * on anything the closure grammar rejects.
+ */
+namespace machine {
+enum class Rule {
+    Json,
+    Value,
+    Object,
+    Array,
+};
+
+enum class Kind {
+    String,
+    Number,
+    Object,
+    Array,
+    Member,
+};
+
+inline pc::vm::Program json() {
+    using namespace pc::vm;
+
+    auto ws = many_any(alt(chr(' '), chr('\n'), chr('\t')));
+    auto hex = alt(char_range('0', '9'), char_range('a', 'f'), char_range('A', 'F'));
+    auto escape = seq(chr('\\'), alt(chr('"'), chr('\\'), chr('/'), chr('b'), chr('f'), chr('n'), chr('r'), chr('t'),
+                                     seq(chr('u'), hex, hex, hex, hex)));
+    auto character = alt(escape, char_range(' ', '!'), char_range('#', '['), char_range(']', '\x7F'), char_range('\x80', '\xFF'));
+    auto string = capture(Kind::String, seq(chr('"'), many_any(character), chr('"')));
+    auto number = capture(Kind::Number, seq(maybe(chr('-')), many_more(1, char_range('0', '9'))));
+
+    auto element = seq(ws, rule(Rule::Value), ws);
+    auto member = capture(Kind::Member, seq(ws, string, ws, chr(':'), element));
+
+    Grammar grammar;
+    grammar.define(Rule::Json, element);
+    grammar.define(Rule::Value, alt(string, number, nested(rule(Rule::Object)), nested(rule(Rule::Array))));
+    grammar.define(Rule::Array, capture(Kind::Array, seq(chr('['), alt(seq(ws, chr(']')),
+                                                                         seq(many_any_separated_by(element, chr(',')), chr(']'))))));
+    grammar.define(Rule::Object, capture(Kind::Object, seq(chr('{'), alt(seq(ws, chr('}')),
+                                                                           seq(many_any_separated_by(member, chr(',')), chr('}'))))));
+
+    return grammar.compile(Rule::Json);
+}
+
+inline pc::ParseResult<Json> from_captures(pc::StringRef input, const pc::vm::Captures &captures) {
+    struct Frame {
+        Kind kind;
+        size_t offset;
+        Value value;
+        std::optional<std::string> key;
+    };
+
+    std::vector<Frame> stack;
+    Json result;
+
+    auto emit = [&](Value value) {
+        if (stack.empty()) {
+            result = std::move(value);
+            return;
+        }
+
+        auto &top = stack.back();
+        if (top.kind == Kind::Array)
+            std::get<Array>(top.value).push_back(std::move(value));
+        else if (!top.key)
+            top.key = std::get<String>(std::move(value));
+        else
+            top.value = std::move(value);
+    };
+
+    for (const auto &capture: captures) {
+        auto kind = static_cast<Kind>(capture.kind);
+
+        if (capture.event == pc::vm::CaptureEvent::Open) {
+            Value value;
+            if (kind == Kind::Object)
+                value = Object{};
+            else if (kind == Kind::Array)
+                value = Array{};
+
+            stack.push_back(Frame{kind, capture.offset, std::move(value), std::nullopt});
+            continue;
+        }
+
+        auto frame = std::move(stack.back());
+        stack.pop_back();
+
+        auto span = input.substr(frame.offset, capture.offset - frame.offset);
+        switch (kind) {
+            case Kind::String: {
+                PC_EXPECT_ASSIGN(string, pc::json_string()(span));
+                emit(std::move(string));
+                break;
+            }
+            case Kind::Number: {
+                Number number = 0;
+                std::from_chars(span.data(), span.data() + span.size(), number);
+                emit(number);
+                break;
+            }
+            case Kind::Member:
+                std::get<Object>(stack.back().value)[*frame.key] = std::move(frame.value);
+                break;
+            case Kind::Object:
+            case Kind::Array:
+                emit(std::move(frame.value));
+                break;
+        }
+    }
+
+    return result;
+}
+}// namespace machine
+}// namespace js